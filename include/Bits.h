@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace Bits {
+
+// Transpose an 8x8 bit matrix held as eight row bytes, using the
+// bit-parallel swap network from Hacker's Delight (transpose8rS32).
+// Row r of `in` is in[r] with its most significant bit as column 0;
+// out[c] receives column c with row 0 as its most significant bit.
+inline void transpose8x8(const uint8_t in[8], uint8_t out[8]) {
+  uint32_t x = ((uint32_t)in[0] << 24) | ((uint32_t)in[1] << 16) | ((uint32_t)in[2] << 8) | in[3];
+  uint32_t y = ((uint32_t)in[4] << 24) | ((uint32_t)in[5] << 16) | ((uint32_t)in[6] << 8) | in[7];
+  uint32_t t;
+
+  t = (x ^ (x >> 7)) & 0x00AA00AAUL;  x = x ^ t ^ (t << 7);
+  t = (y ^ (y >> 7)) & 0x00AA00AAUL;  y = y ^ t ^ (t << 7);
+
+  t = (x ^ (x >> 14)) & 0x0000CCCCUL;  x = x ^ t ^ (t << 14);
+  t = (y ^ (y >> 14)) & 0x0000CCCCUL;  y = y ^ t ^ (t << 14);
+
+  t = (x & 0xF0F0F0F0UL) | ((y >> 4) & 0x0F0F0F0FUL);
+  y = ((x << 4) & 0xF0F0F0F0UL) | (y & 0x0F0F0F0FUL);
+  x = t;
+
+  out[0] = (uint8_t)(x >> 24); out[1] = (uint8_t)(x >> 16); out[2] = (uint8_t)(x >> 8); out[3] = (uint8_t)x;
+  out[4] = (uint8_t)(y >> 24); out[5] = (uint8_t)(y >> 16); out[6] = (uint8_t)(y >> 8); out[7] = (uint8_t)y;
+}
+
+// Reverse the bit order of a word (bit 0 <-> most significant bit) with
+// the usual swap-halves network.
+inline uint32_t reverse(uint32_t x) {
+  x = ((x >> 1) & 0x55555555UL) | ((x & 0x55555555UL) << 1);
+  x = ((x >> 2) & 0x33333333UL) | ((x & 0x33333333UL) << 2);
+  x = ((x >> 4) & 0x0F0F0F0FUL) | ((x & 0x0F0F0F0FUL) << 4);
+  x = ((x >> 8) & 0x00FF00FFUL) | ((x & 0x00FF00FFUL) << 8);
+  return (x >> 16) | (x << 16);
+}
+
+inline uint64_t reverse(uint64_t x) {
+  return ((uint64_t)reverse((uint32_t)x) << 32) | reverse((uint32_t)(x >> 32));
+}
+
+// Number of set bits in a row mask
+inline uint8_t popcount(uint32_t x) {
+  return (uint8_t)__builtin_popcountl(x);
+}
+
+inline uint8_t popcount(uint64_t x) {
+  return (uint8_t)__builtin_popcountll(x);
+}
+
+// The n-th lowest set bit of x (counting from 0) as a one-bit mask, or 0
+// if x has n or fewer bits set.
+template<typename T>
+inline T nthSetBit(T x, uint8_t n) {
+  while (n-- && x) {
+    x &= (T)(x - 1);
+  }
+  return (T)(x & (T)(~x + 1));
+}
+
+} // namespace Bits
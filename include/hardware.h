@@ -3,12 +3,32 @@
 #define PIN_DIN D7
 #define PIN_CLK D5
 #define PIN_CS  D8
+
+// Panel geometry. Defaults to a 32x8 panel of four MAX7219s; other panels
+// can be selected with build flags, e.g. the 32x32 build uses
+// -D LED_MATRIX_ROWS=32 -D NUM_DEVICES=16.
+#ifndef NUM_DEVICES
 #define NUM_DEVICES 4
+#endif
 
+// PIN_DIN and PIN_CLK are the HSPI MOSI and SCK pins, so the chain is driven
+// by the SPI peripheral. The MAX7219 accepts up to 10MHz. Build with
+// -D LED_MATRIX_BITBANG to fall back to shifting bits out over GPIO.
+#ifndef LED_MATRIX_SPI_HZ
+#define LED_MATRIX_SPI_HZ 8000000
+#endif
+// Digit registers pushed per loop() iteration while a frame is flushed. Each
+// digit is one transaction for the whole chain; a full frame is 8 digits.
+#ifndef LED_MATRIX_FLUSH_DIGITS_PER_STEP
+#define LED_MATRIX_FLUSH_DIGITS_PER_STEP 2
+#endif
+
+#ifndef LED_MATRIX_ROWS
 #define LED_MATRIX_ROWS 8
-#define LED_MATRIX_ROWS_STR "8"
+#endif
+#ifndef LED_MATRIX_COLS
 #define LED_MATRIX_COLS 32
-#define LED_MATRIX_COLS_STR "32"
+#endif
 #define LED_MATRIX_BRIGHTNESS_MIN 0
 #define LED_MATRIX_BRIGHTNESS_MAX 15
 
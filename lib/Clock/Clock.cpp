@@ -15,14 +15,20 @@
 // NTP server to use
 static const char* NTP_SERVER = "pool.ntp.org";
 
+bool Clock::timeInitialized = false;
+
 Clock::Clock(Display* display)
-  : Visualization(display, 500), colonOn(true), timeInitialized(false) {
+  : Visualization(display, BLINK_INTERVAL_MS), colonOn(true), blinkAccumulator(0) {
   initTimeOnce();
 }
 
-bool Clock::run() {
-  // Toggle colon each tick (500ms)
-  colonOn = !colonOn;
+bool Clock::advance(unsigned long elapsedMs) {
+  // Toggle the colon once per blink interval that actually passed
+  blinkAccumulator += elapsedMs;
+  while (blinkAccumulator >= BLINK_INTERVAL_MS) {
+    colonOn = !colonOn;
+    blinkAccumulator -= BLINK_INTERVAL_MS;
+  }
   render();
   return true;
 }
@@ -122,19 +128,9 @@ void Clock::drawString(const char* s) {
   uint8_t x = startX;
   for (const char* p = s; *p; ++p) {
     if (x + glyphW > maxWidth) break;
-    Font4x6::Glyph g = Font4x6::glyphFor(*p);
-    for (uint8_t cx = 0; cx < glyphW; ++cx) {
-      uint8_t col = g.cols[cx];
-      for (uint8_t ry = 0; ry < Font4x6::HEIGHT; ++ry) {
-        bool on = ((col >> ry) & 0x01) != 0;
-        if (on) {
-          uint8_t y = (uint8_t)(yOffset + ry);
-          if (y < maxHeight) {
-            display->setPixel(x + cx, y, true);
-          }
-        }
-      }
-    }
+    uint8_t rows[Font4x6::HEIGHT];
+    Font4x6::rowsFor(*p, rows);
+    display->blit(x, yOffset, rows, glyphW, Font4x6::HEIGHT, RasterOp::OR);
     x = (uint8_t)(x + glyphW + spacing);
   }
 }
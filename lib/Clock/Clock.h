@@ -5,16 +5,21 @@
 
 class Clock : public Visualization {
 public:
-  // Refresh every 500ms so the colon can blink
+  // The colon blinks on and off for this long each
+  static constexpr unsigned long BLINK_INTERVAL_MS = 500;
+
+  // Refresh every BLINK_INTERVAL_MS so the colon can blink
   explicit Clock(Display* display);
 
 protected:
-  bool run() override;
+  bool advance(unsigned long elapsedMs) override;
   void render() override;
 
 private:
   bool colonOn;
-  bool timeInitialized;
+  unsigned long blinkAccumulator;
+  // Time zone and SNTP are configured once per boot, not per instance
+  static bool timeInitialized;
 
   void initTimeOnce();
   void drawString(const char* s);
@@ -1,16 +1,29 @@
 #include "Columns.h"
-#include "hardware.h"
 
 Columns::Columns(Display* display, unsigned long speed, bool bounce)
-: Visualization(display, speed), bounce(bounce), movingRight(true), currentColumn(0)
+: Visualization(display, speed), speed(speed), stepAccumulator(0), bounce(bounce), movingRight(true), currentColumn(0)
 {}
 
-bool Columns::run() {
+bool Columns::advance(unsigned long elapsedMs) {
   render();
+  if (speed == 0) {
+    return true;
+  }
+  // The column on screen moves on once per `speed` ms; a late tick takes
+  // all the steps it missed.
+  stepAccumulator += elapsedMs;
+  while (stepAccumulator >= speed) {
+    step();
+    stepAccumulator -= speed;
+  }
+  return true;
+}
+
+void Columns::step() {
   if (bounce) {
     if (movingRight) {
       ++currentColumn;
-      if (currentColumn == LED_MATRIX_COLS - 1) {
+      if (currentColumn == Display::COLUMNS - 1) {
         movingRight = false;
       }
     } else {
@@ -21,15 +34,12 @@ bool Columns::run() {
 
     }
   } else {
-    currentColumn = (currentColumn + 1) % LED_MATRIX_COLS;
+    currentColumn = (currentColumn + 1) % Display::COLUMNS;
   }
-  return true;
 }
 
 void Columns::render() {
-  for (uint8_t x = 0; x < LED_MATRIX_COLS; ++x) {
-    for (uint8_t y = 0; y < LED_MATRIX_ROWS; ++y) {
-      display->setPixel(x, y, x == currentColumn);
-    }
+  for (uint8_t y = 0; y < Display::ROWS; ++y) {
+    display->setRow(y, Display::bit(currentColumn));
   }
 }
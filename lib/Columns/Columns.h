@@ -8,10 +8,14 @@ public:
   Columns(Display* display, unsigned long speed = 50, bool bounce = false);
   
 protected:
-  bool run() override;
+  bool advance(unsigned long elapsedMs) override;
   void render() override;
 
 private:
+  void step();
+
+  unsigned long speed;
+  unsigned long stepAccumulator;
   bool bounce;
   bool movingRight;
   uint8_t currentColumn;
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Fixed-capacity single-producer, single-consumer ring buffer.
+//
+// One context pushes (the async web handlers, which all run in the network
+// stack's context), another pops (loop()). Each side only writes its own
+// index and publishes it with release ordering after touching the slots, so
+// no lock is needed. A multi-item push() becomes visible to the consumer
+// all at once.
+template<typename T, uint8_t Capacity>
+class CommandQueue {
+  static_assert(Capacity > 0 && Capacity <= 128 && (Capacity & (Capacity - 1)) == 0,
+                "capacity must be a power of two no larger than 128");
+
+public:
+  CommandQueue() : slots{}, head(0), tail(0) {}
+
+  // Append `count` items, or nothing if they do not all fit
+  bool push(const T* items, size_t count) {
+    const uint8_t t = tail.load(std::memory_order_relaxed);
+    const uint8_t h = head.load(std::memory_order_acquire);
+    if (count > (size_t)(Capacity - (uint8_t)(t - h))) {
+      return false;
+    }
+    for (size_t i = 0; i < count; ++i) {
+      slots[(uint8_t)(t + i) & (Capacity - 1)] = items[i];
+    }
+    tail.store((uint8_t)(t + count), std::memory_order_release);
+    return true;
+  }
+
+  bool push(const T& item) {
+    return push(&item, 1);
+  }
+
+  bool pop(T& item) {
+    const uint8_t h = head.load(std::memory_order_relaxed);
+    if (h == tail.load(std::memory_order_acquire)) {
+      return false;
+    }
+    item = slots[h & (Capacity - 1)];
+    head.store((uint8_t)(h + 1), std::memory_order_release);
+    return true;
+  }
+
+  // Room left for the producer; only grows until it pushes again
+  size_t available() const {
+    return Capacity - (uint8_t)(tail.load(std::memory_order_relaxed) - head.load(std::memory_order_acquire));
+  }
+
+  bool empty() const {
+    return head.load(std::memory_order_relaxed) == tail.load(std::memory_order_acquire);
+  }
+
+private:
+  T slots[Capacity];
+  // Free-running positions; their difference is the fill level
+  std::atomic<uint8_t> head;
+  std::atomic<uint8_t> tail;
+};
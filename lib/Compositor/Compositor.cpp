@@ -0,0 +1,168 @@
+#include "Compositor.h"
+
+#include <string.h>
+
+namespace {
+struct OpName {
+  const char* name;
+  RasterOp op;
+};
+
+constexpr OpName OP_NAMES[] = {
+  {"copy", RasterOp::COPY},
+  {"or", RasterOp::OR},
+  {"mask", RasterOp::AND},
+  {"xor", RasterOp::XOR},
+};
+}
+
+Compositor::Compositor(Display* output)
+: output(output),
+  layers{},
+  layersChanged(true),
+  base{},
+  composed{}
+{
+  for (Layer& layer : layers) {
+    layer.definition = nullptr;
+    layer.visualization = nullptr;
+    layer.op = RasterOp::OR;
+  }
+}
+
+Compositor::~Compositor() {
+  clear();
+}
+
+bool Compositor::setLayer(uint8_t index, const VisualizationDefinition* definition, RasterOp op) {
+  if (index >= MAX_LAYERS || !definition || !definition->create) {
+    return false;
+  }
+  clearLayer(index);
+  Layer& layer = layers[index];
+  layer.visualization = definition->create(&layer.plane, layer.storage.bytes);
+  layer.definition = definition;
+  layer.op = op;
+  layersChanged = true;
+  return true;
+}
+
+bool Compositor::setLayerOp(uint8_t index, RasterOp op) {
+  if (index >= MAX_LAYERS) {
+    return false;
+  }
+  layers[index].op = op;
+  layersChanged = true;
+  return true;
+}
+
+void Compositor::clearLayer(uint8_t index) {
+  if (index >= MAX_LAYERS) {
+    return;
+  }
+  Layer& layer = layers[index];
+  if (layer.visualization) {
+    layer.visualization->~Visualization();
+    layer.visualization = nullptr;
+    layer.definition = nullptr;
+    layer.plane.clear();
+    layer.plane.present();
+    layersChanged = true;
+  }
+}
+
+void Compositor::clear() {
+  for (uint8_t i = 0; i < MAX_LAYERS; ++i) {
+    clearLayer(i);
+  }
+}
+
+const VisualizationDefinition* Compositor::layerDefinition(uint8_t index) const {
+  return index < MAX_LAYERS ? layers[index].definition : nullptr;
+}
+
+RasterOp Compositor::layerOp(uint8_t index) const {
+  return index < MAX_LAYERS ? layers[index].op : RasterOp::OR;
+}
+
+const char* Compositor::opName(RasterOp op) {
+  for (const OpName& entry : OP_NAMES) {
+    if (entry.op == op) {
+      return entry.name;
+    }
+  }
+  return "";
+}
+
+bool Compositor::parseOp(const char* name, RasterOp* op) {
+  if (!name || !op) {
+    return false;
+  }
+  for (const OpName& entry : OP_NAMES) {
+    if (strcmp(entry.name, name) == 0) {
+      *op = entry.op;
+      return true;
+    }
+  }
+  return false;
+}
+
+void Compositor::check(unsigned long now) {
+  for (Layer& layer : layers) {
+    if (layer.visualization) {
+      layer.visualization->check(now);
+    }
+  }
+}
+
+unsigned long Compositor::msUntilDue(unsigned long now) const {
+  unsigned long due = (unsigned long)-1;
+  for (const Layer& layer : layers) {
+    if (layer.visualization) {
+      const unsigned long ms = layer.visualization->msUntilDue(now);
+      if (ms < due) {
+        due = ms;
+      }
+    }
+  }
+  return due;
+}
+
+const Display::Row* Compositor::compose() {
+  bool changed = layersChanged;
+  layersChanged = false;
+  for (Layer& layer : layers) {
+    // Publishing a plane reports whether its visualization drew anything new
+    if (layer.visualization && layer.plane.present()) {
+      changed = true;
+    }
+  }
+  for (uint8_t y = 0; y < Display::ROWS; ++y) {
+    const Row row = output ? output->row(y) : 0;
+    if (row != base[y]) {
+      base[y] = row;
+      changed = true;
+    }
+  }
+  if (!changed) {
+    return composed;
+  }
+
+  memcpy(composed, base, sizeof(composed));
+  for (const Layer& layer : layers) {
+    if (!layer.visualization) {
+      continue;
+    }
+    for (uint8_t y = 0; y < Display::ROWS; ++y) {
+      const Row bits = layer.plane.rowBits(y);
+      Row& target = composed[y];
+      switch (layer.op) {
+        case RasterOp::COPY: target = bits; break;
+        case RasterOp::OR:   target |= bits; break;
+        case RasterOp::AND:  target &= bits; break;
+        case RasterOp::XOR:  target ^= bits; break;
+      }
+    }
+  }
+  return composed;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "Display.h"
+#include "Visualization.h"
+#include "Visualizations.h"
+#include "VisualizationStorage.h"
+
+// Stacks overlay visualizations on top of the current one.
+//
+// Each layer runs its own visualization instance drawing into a private
+// bit-plane. compose() combines the base frame (the output display's back
+// buffer) with the layers in index order, one row mask at a time, using
+// each layer's RasterOp: OR adds its pixels, XOR inverts under them, AND
+// masks the picture to them and COPY replaces everything below. The result
+// is only recomputed when the base or a layer changed.
+class Compositor {
+public:
+  static constexpr uint8_t MAX_LAYERS = 3;
+
+  explicit Compositor(Display* output);
+  ~Compositor();
+
+  // Put a fresh instance of `definition` on layer `index`, replacing what
+  // was there. Returns false for an invalid index or definition.
+  bool setLayer(uint8_t index, const VisualizationDefinition* definition, RasterOp op);
+  bool setLayerOp(uint8_t index, RasterOp op);
+  void clearLayer(uint8_t index);
+  void clear();
+
+  // nullptr for an empty layer
+  const VisualizationDefinition* layerDefinition(uint8_t index) const;
+  RasterOp layerOp(uint8_t index) const;
+
+  static const char* opName(RasterOp op);
+  // Accepts "copy", "or", "xor" and "mask" (AND). Returns false, leaving
+  // `op` alone, for an unknown name.
+  static bool parseOp(const char* name, RasterOp* op);
+
+  // Tick the layer visualizations
+  void check(unsigned long now);
+  // Milliseconds from `now` until a layer visualization is due
+  unsigned long msUntilDue(unsigned long now) const;
+
+  // The output display's back buffer with every layer applied, ready for
+  // Display::present(frame)
+  const Display::Row* compose();
+
+private:
+  using Row = Display::Row;
+
+  struct Layer {
+    const VisualizationDefinition* definition;
+    Visualization* visualization;
+    RasterOp op;
+    Display plane;
+    VisualizationStorage storage;
+  };
+
+  Display* output;
+  Layer layers[MAX_LAYERS];
+  // A layer was added, removed or changed its operator since compose()
+  bool layersChanged;
+  // Base frame the current composition was built from
+  Row base[Display::ROWS];
+  Row composed[Display::ROWS];
+};
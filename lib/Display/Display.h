@@ -1,23 +1,275 @@
 #pragma once
 
 #include <stdlib.h>
+#include <stdint.h>
+#include <type_traits>
+
+#include "hardware.h"
+
+// How source bits are combined with what is already in the back buffer
+enum class RasterOp : uint8_t {
+  COPY,
+  OR,
+  AND,
+  XOR,
+};
+
+// Word used to hold one row of `Columns` pixels, column 0 in bit 0
+template <uint8_t Columns>
+using RowWord = typename std::conditional<(Columns <= 32), uint32_t, uint64_t>::type;
+
+// Double-buffered 1-bit frame buffer with its geometry fixed at compile time.
+//
+// Drawing calls (setPixel, the row-wise raster operations, clear, fill,
+// getPixel) work on the back buffer.
+// Nothing drawn there becomes visible until present() publishes it as the
+// front buffer, which is what rowBits() returns to LedMatrix and the web
+// server. Readers therefore only ever see complete frames, even when a
+// visualization clears and redraws, or a web request edits the back buffer
+// mid-frame.
+template <uint8_t Columns, uint8_t Rows>
+class BasicDisplay {
+  static_assert(Columns > 0 && Columns <= 64, "rows wider than 64 pixels need a multi-word row type");
+  static_assert(Rows > 0 && Rows % 8 == 0, "rows are driven in bands of 8");
 
-class Display {
 public:
-  Display();
-
-  bool setPixel(uint8_t x, uint8_t y, bool on);
-  bool getPixel(uint8_t x, uint8_t y);
-  uint8_t width() const;
-  uint8_t height() const;
-  uint32_t rowBits(uint8_t y) const;
-  
-  bool needsRefresh();
-  void refresh();
-  void clear();
-  void fill(bool on);
+  using Row = RowWord<Columns>;
+
+  static constexpr uint8_t COLUMNS = Columns;
+  static constexpr uint8_t ROWS = Rows;
+  // Each band of 8 rows is driven by one row of MAX7219s
+  static constexpr uint8_t BANDS = Rows / 8;
+  static constexpr Row FULL_ROW = Columns == sizeof(Row) * 8 ? (Row)~(Row)0 : (Row)(((Row)1 << (Columns % (sizeof(Row) * 8))) - 1);
+
+  static constexpr Row bit(uint8_t x) {
+    return (Row)((Row)1 << x);
+  }
+
+  BasicDisplay() : frameSequence(0), dirty{}, back{}, front{} {}
+
+  bool setPixel(uint8_t x, uint8_t y, bool on) {
+    bool changed = false;
+    if (x < Columns && y < Rows) {
+      changed = this->getPixel(x, y) != on;
+      if (on) {
+        back[y] |= bit(x);
+      }  else {
+        back[y] &= (Row)~bit(x);
+      }
+    }
+    return changed;
+  }
+
+  bool getPixel(uint8_t x, uint8_t y) const {
+    if (x < Columns && y < Rows) {
+      return (back[y] >> x) & 1U;
+    }
+    return false;
+  }
+
+  static constexpr uint8_t width() {
+    return Columns;
+  }
+
+  static constexpr uint8_t height() {
+    return Rows;
+  }
+
+  // Row y of the back buffer
+  Row row(uint8_t y) const {
+    return y < Rows ? back[y] : 0;
+  }
+
+  void setRow(uint8_t y, Row bits) {
+    if (y < Rows) {
+      back[y] = bits & FULL_ROW;
+    }
+  }
+
+  // Combine a whole row mask into row y
+  void applyRow(uint8_t y, Row bits, RasterOp op) {
+    applyRow(y, bits, FULL_ROW, op);
+  }
+
+  // Combine `bits` into row y, touching only the columns set in `window`.
+  // COPY replaces the window with `bits`; AND clears window bits not in
+  // `bits`.
+  void applyRow(uint8_t y, Row bits, Row window, RasterOp op) {
+    if (y >= Rows) {
+      return;
+    }
+    window &= FULL_ROW;
+    bits &= window;
+    Row& target = back[y];
+    switch (op) {
+      case RasterOp::COPY: target = (Row)((target & ~window) | bits); break;
+      case RasterOp::OR:   target |= bits; break;
+      case RasterOp::AND:  target &= (Row)(bits | ~window); break;
+      case RasterOp::XOR:  target ^= bits; break;
+    }
+  }
+
+  // Draw a bitmap `height` rows tall and up to `width` columns wide with
+  // its top-left corner at (x, y). Each source row keeps its leftmost pixel
+  // in bit 0. Parts falling outside the display are clipped.
+  template <typename T>
+  void blit(int16_t x, int16_t y, const T* rows, uint8_t width, uint8_t height, RasterOp op) {
+    const Row window = place(lowBits(width), x);
+    if (!window) {
+      return;
+    }
+    for (uint8_t r = 0; r < height; ++r) {
+      const int16_t ty = (int16_t)(y + r);
+      if (ty < 0 || ty >= Rows) {
+        continue;
+      }
+      applyRow((uint8_t)ty, place((Row)rows[r] & lowBits(width), x), window, op);
+    }
+  }
+
+  // Turn the given columns on or off in every row
+  void fillMasked(Row columns, bool on) {
+    columns &= FULL_ROW;
+    for (uint8_t y = 0; y < Rows; y++) {
+      if (on) {
+        back[y] |= columns;
+      } else {
+        back[y] &= (Row)~columns;
+      }
+    }
+  }
+
+  // Move the frame by dx columns (positive is right) and dy rows (positive
+  // is down). Uncovered pixels are cleared, or filled from the opposite
+  // edge when wrap is set.
+  void shift(int16_t dx, int16_t dy, bool wrap = false) {
+    if (wrap) {
+      dx = (int16_t)(((dx % Columns) + Columns) % Columns);
+      dy = (int16_t)(((dy % Rows) + Rows) % Rows);
+    }
+    if (dx) {
+      for (uint8_t y = 0; y < Rows; y++) {
+        Row bits = back[y];
+        Row moved = place(bits, dx);
+        if (wrap) {
+          moved |= place(bits, (int16_t)(dx - Columns));
+        }
+        back[y] = moved;
+      }
+    }
+    if (dy) {
+      Row moved[Rows];
+      for (uint8_t y = 0; y < Rows; y++) {
+        const int16_t source = (int16_t)(y - dy);
+        moved[y] = (source >= 0 && source < Rows) ? back[source] : wrap ? back[(source + Rows) % Rows] : 0;
+      }
+      for (uint8_t y = 0; y < Rows; y++) {
+        back[y] = moved[y];
+      }
+    }
+  }
+
+  // Row y of the presented (front) frame
+  Row rowBits(uint8_t y) const {
+    if (y < Rows) {
+      return front[y];
+    }
+    return 0;
+  }
+
+  // Publish the back buffer. Returns true if the visible frame changed.
+  bool present() {
+    // Copy rather than swap pointers: visualizations draw incrementally, so
+    // the back buffer has to keep holding the frame that was just published.
+    return present(back);
+  }
+
+  // Publish `frame`, Rows row masks, in place of the back buffer, which is
+  // left untouched. Used for frames composed outside the display, such as
+  // transitions.
+  bool present(const Row* frame) {
+    Row changed = 0;
+    for (uint8_t band = 0; band < BANDS; band++) {
+      Row bandChanged = 0;
+      for (uint8_t y = band * 8; y < band * 8 + 8; y++) {
+        // Only the columns that actually flip need to be pushed to the panel
+        const Row next = frame[y] & FULL_ROW;
+        bandChanged |= front[y] ^ next;
+        front[y] = next;
+      }
+      dirty[band] |= bandChanged;
+      changed |= bandChanged;
+    }
+    if (changed) {
+      frameSequence++;
+    }
+    return changed != 0;
+  }
+
+  // Number of times present() changed the visible frame. Readers that
+  // remember it can tell whether they already have the current frame.
+  uint32_t sequence() const {
+    return frameSequence;
+  }
+
+  // Bitmask of columns in rows [band * 8, band * 8 + 8) whose presented
+  // pixels changed since the last refresh(). Bit x of band b corresponds to
+  // one MAX7219 digit register.
+  Row dirtyColumns(uint8_t band) const {
+    return band < BANDS ? dirty[band] : 0;
+  }
+
+  bool needsRefresh() const {
+    Row any = 0;
+    for (uint8_t band = 0; band < BANDS; band++) {
+      any |= dirty[band];
+    }
+    return any != 0;
+  }
+
+  void refresh() {
+    for (uint8_t band = 0; band < BANDS; band++) {
+      dirty[band] = 0;
+    }
+  }
+
+  void clear() {
+    fill(false);
+  }
+
+  void fill(bool on) {
+    const Row value = on ? FULL_ROW : 0;
+    for (uint8_t y = 0; y < Rows; y++) {
+      back[y] = value;
+    }
+  }
 
 private:
-  bool dirty;
-  uint32_t* frameBuffer;
+  static constexpr Row lowBits(uint8_t count) {
+    return count >= sizeof(Row) * 8 ? (Row)~(Row)0 : (Row)(((Row)1 << count) - 1);
+  }
+
+  // Shift a row mask so that bit 0 lands on column x, clipped to the display
+  static constexpr Row place(Row bits, int16_t x) {
+    return x >= Columns || x <= -(int16_t)(sizeof(Row) * 8) ? 0
+         : x >= 0 ? (Row)((Row)(bits << x) & FULL_ROW)
+         : (Row)(bits >> -x);
+  }
+
+  uint32_t frameSequence;
+  Row dirty[BANDS];
+  Row back[Rows];
+  Row front[Rows];
 };
+
+template <uint8_t Columns, uint8_t Rows>
+constexpr uint8_t BasicDisplay<Columns, Rows>::COLUMNS;
+template <uint8_t Columns, uint8_t Rows>
+constexpr uint8_t BasicDisplay<Columns, Rows>::ROWS;
+template <uint8_t Columns, uint8_t Rows>
+constexpr uint8_t BasicDisplay<Columns, Rows>::BANDS;
+template <uint8_t Columns, uint8_t Rows>
+constexpr typename BasicDisplay<Columns, Rows>::Row BasicDisplay<Columns, Rows>::FULL_ROW;
+
+// The display matching the panel described in hardware.h
+using Display = BasicDisplay<LED_MATRIX_COLS, LED_MATRIX_ROWS>;
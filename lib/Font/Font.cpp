@@ -0,0 +1,68 @@
+#include "Font.h"
+
+#include <string.h>
+#include <utility>
+
+#if defined(ARDUINO)
+#include <Arduino.h>
+#else
+#define PROGMEM
+#define memcpy_P memcpy
+#endif
+
+namespace {
+
+template <uint8_t Height>
+struct GlyphRows {
+  uint8_t rows[Height];
+};
+
+template <uint8_t Height, size_t Count>
+struct Atlas {
+  GlyphRows<Height> glyphs[Count];
+};
+
+// Transpose a column-major glyph into row masks with column 0 in bit 0
+template <uint8_t Width, uint8_t Height, typename Glyph>
+constexpr GlyphRows<Height> transpose(const Glyph& glyph) {
+  GlyphRows<Height> out{};
+  for (uint8_t ry = 0; ry < Height; ++ry) {
+    for (uint8_t cx = 0; cx < Width; ++cx) {
+      out.rows[ry] |= (uint8_t)(((glyph.cols[cx] >> ry) & 0x01) << cx);
+    }
+  }
+  return out;
+}
+
+template <size_t... I>
+constexpr Atlas<Font3x5::HEIGHT, Font3x5::GLYPH_COUNT> makeAtlas3x5(std::index_sequence<I...>) {
+  return {{ transpose<Font3x5::WIDTH, Font3x5::HEIGHT>(Font3x5::glyphFor((char)(Font3x5::FIRST_CHAR + I)))... }};
+}
+
+template <size_t... I>
+constexpr Atlas<Font4x6::HEIGHT, Font4x6::GLYPH_COUNT> makeAtlas4x6(std::index_sequence<I...>) {
+  return {{ transpose<Font4x6::WIDTH, Font4x6::HEIGHT>(Font4x6::glyphFor((char)(Font4x6::FIRST_CHAR + I)))... }};
+}
+
+const Atlas<Font3x5::HEIGHT, Font3x5::GLYPH_COUNT> ATLAS_3X5 PROGMEM =
+  makeAtlas3x5(std::make_index_sequence<Font3x5::GLYPH_COUNT>());
+
+const Atlas<Font4x6::HEIGHT, Font4x6::GLYPH_COUNT> ATLAS_4X6 PROGMEM =
+  makeAtlas4x6(std::make_index_sequence<Font4x6::GLYPH_COUNT>());
+
+size_t atlasIndex(char ch) {
+  if (ch < Font3x5::FIRST_CHAR || ch > Font3x5::LAST_CHAR) {
+    ch = '?';
+  }
+  return (size_t)(ch - Font3x5::FIRST_CHAR);
+}
+
+}  // namespace
+
+void Font3x5::rowsFor(char ch, uint8_t rows[HEIGHT]) {
+  memcpy_P(rows, ATLAS_3X5.glyphs[atlasIndex(ch)].rows, HEIGHT);
+}
+
+void Font4x6::rowsFor(char ch, uint8_t rows[HEIGHT]) {
+  memcpy_P(rows, ATLAS_4X6.glyphs[atlasIndex(ch)].rows, HEIGHT);
+}
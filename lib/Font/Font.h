@@ -1,7 +1,13 @@
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 
+// Glyphs are defined once as columns by the constexpr glyphFor() functions
+// below. Font.cpp turns them into atlases at compile time: one entry per
+// printable ASCII character, already transposed into row masks and stored
+// in flash. Rendering a character is then a table lookup and a blit.
+
 namespace Font3x5 {
 
 // Basic 3x5 pixel font
@@ -11,13 +17,17 @@ static constexpr uint8_t WIDTH = 3;
 static constexpr uint8_t HEIGHT = 5;
 static constexpr uint8_t SPACING = 1;
 
+static constexpr char FIRST_CHAR = ' ';
+static constexpr char LAST_CHAR = '~';
+static constexpr size_t GLYPH_COUNT = LAST_CHAR - FIRST_CHAR + 1;
+
 struct Glyph {
   uint8_t cols[WIDTH];
 };
 
 // Return glyph columns for a character.
 // Unknown characters map to '?'.
-inline Glyph glyphFor(char ch) {
+constexpr Glyph glyphFor(char ch) {
   char c = ch;
   switch (c) {
     // Space and simple punctuation
@@ -76,6 +86,10 @@ inline Glyph glyphFor(char ch) {
   }
 }
 
+// Glyph as row masks, bit 0 = leftmost column, ready to blit into a Display.
+// Reads the precomputed atlas; characters outside it map to '?'.
+void rowsFor(char ch, uint8_t rows[HEIGHT]);
+
 } // namespace Font3x5
 
 // 4x6 font derived from 3x5 by simple scaling
@@ -85,11 +99,15 @@ static constexpr uint8_t WIDTH = 4;
 static constexpr uint8_t HEIGHT = 6;
 static constexpr uint8_t SPACING = 1;
 
+static constexpr char FIRST_CHAR = Font3x5::FIRST_CHAR;
+static constexpr char LAST_CHAR = Font3x5::LAST_CHAR;
+static constexpr size_t GLYPH_COUNT = Font3x5::GLYPH_COUNT;
+
 struct Glyph {
   uint8_t cols[WIDTH];
 };
 
-inline uint8_t scaleCol5to6(uint8_t col5) {
+constexpr uint8_t scaleCol5to6(uint8_t col5) {
   uint8_t col6 = 0;
   for (uint8_t r = 0; r < 6; ++r) {
     uint8_t src = (uint8_t)((r * 5) / 6); // 0,0,1,2,3,4
@@ -98,17 +116,18 @@ inline uint8_t scaleCol5to6(uint8_t col5) {
   return col6;
 }
 
-inline Glyph glyphFor(char ch) {
-  auto g3 = Font3x5::glyphFor(ch);
-  Glyph g6;
-  uint8_t c0 = scaleCol5to6(g3.cols[0]);
-  uint8_t c1 = scaleCol5to6(g3.cols[1]);
-  uint8_t c2 = scaleCol5to6(g3.cols[2]);
-  g6.cols[0] = c0;
-  g6.cols[1] = c1;
-  g6.cols[2] = c1; // widen by duplicating middle column
-  g6.cols[3] = c2;
-  return g6;
+constexpr Glyph glyphFor(char ch) {
+  // Widen by duplicating the middle column
+  return {{
+    scaleCol5to6(Font3x5::glyphFor(ch).cols[0]),
+    scaleCol5to6(Font3x5::glyphFor(ch).cols[1]),
+    scaleCol5to6(Font3x5::glyphFor(ch).cols[1]),
+    scaleCol5to6(Font3x5::glyphFor(ch).cols[2]),
+  }};
 }
 
+// Glyph as row masks, bit 0 = leftmost column, ready to blit into a Display.
+// Reads the precomputed atlas; characters outside it map to '?'.
+void rowsFor(char ch, uint8_t rows[HEIGHT]);
+
 } // namespace Font4x6
@@ -0,0 +1,190 @@
+#include "JsonWriter.h"
+
+JsonWriter::JsonWriter(char* buffer, size_t capacity, Print* sink)
+: buffer(buffer),
+  capacity(capacity),
+  sink(sink),
+  used(0),
+  overflow(false),
+  depth(0),
+  empty(1),
+  afterKey(false)
+{
+  if (buffer && capacity > 0) {
+    buffer[0] = '\0';
+  }
+}
+
+JsonWriter& JsonWriter::beginObject() {
+  open('{');
+  return *this;
+}
+
+JsonWriter& JsonWriter::endObject() {
+  close('}');
+  return *this;
+}
+
+JsonWriter& JsonWriter::beginArray() {
+  open('[');
+  return *this;
+}
+
+JsonWriter& JsonWriter::endArray() {
+  close(']');
+  return *this;
+}
+
+JsonWriter& JsonWriter::key(const char* name) {
+  value(name ? name : "");
+  put(':');
+  afterKey = true;
+  return *this;
+}
+
+JsonWriter& JsonWriter::value(const char* text) {
+  if (!text) {
+    return null();
+  }
+  separate();
+  put('"');
+  for (const char* p = text; *p; ++p) {
+    const char c = *p;
+    if (c == '"' || c == '\\') {
+      put('\\');
+      put(c);
+    } else if ((unsigned char)c < 0x20) {
+      static const char HEX_DIGITS[] = "0123456789abcdef";
+      put("\\u00");
+      put(HEX_DIGITS[(unsigned char)c >> 4]);
+      put(HEX_DIGITS[c & 0xF]);
+    } else {
+      put(c);
+    }
+  }
+  put('"');
+  return *this;
+}
+
+JsonWriter& JsonWriter::value(bool flag) {
+  separate();
+  put(flag ? "true" : "false");
+  return *this;
+}
+
+JsonWriter& JsonWriter::value(int number) {
+  return value((long)number);
+}
+
+JsonWriter& JsonWriter::value(unsigned int number) {
+  return value((unsigned long long)number);
+}
+
+JsonWriter& JsonWriter::value(long number) {
+  separate();
+  if (number < 0) {
+    put('-');
+    // Negate in unsigned arithmetic so LONG_MIN survives
+    putUnsigned(0ULL - (unsigned long long)number);
+  } else {
+    putUnsigned((unsigned long long)number);
+  }
+  return *this;
+}
+
+JsonWriter& JsonWriter::value(unsigned long number) {
+  return value((unsigned long long)number);
+}
+
+JsonWriter& JsonWriter::value(unsigned long long number) {
+  separate();
+  putUnsigned(number);
+  return *this;
+}
+
+JsonWriter& JsonWriter::null() {
+  separate();
+  put("null");
+  return *this;
+}
+
+void JsonWriter::flush() {
+  if (sink && used > 0) {
+    sink->write((const uint8_t*)buffer, used);
+    used = 0;
+    buffer[0] = '\0';
+  }
+}
+
+const char* JsonWriter::c_str() const {
+  return buffer && capacity > 0 ? buffer : "";
+}
+
+size_t JsonWriter::length() const {
+  return used;
+}
+
+bool JsonWriter::overflowed() const {
+  return overflow;
+}
+
+void JsonWriter::separate() {
+  if (afterKey) {
+    afterKey = false;
+    return;
+  }
+  const uint16_t bit = (uint16_t)(1U << (depth < MAX_DEPTH ? depth : MAX_DEPTH - 1));
+  if (empty & bit) {
+    empty = (uint16_t)(empty & ~bit);
+  } else {
+    put(',');
+  }
+}
+
+void JsonWriter::open(char bracket) {
+  separate();
+  put(bracket);
+  ++depth;
+  if (depth < MAX_DEPTH) {
+    empty = (uint16_t)(empty | (1U << depth));
+  }
+}
+
+void JsonWriter::close(char bracket) {
+  if (depth > 0) {
+    --depth;
+  }
+  afterKey = false;
+  put(bracket);
+}
+
+void JsonWriter::put(char c) {
+  // One byte stays free for the terminating NUL
+  if (used + 1 >= capacity) {
+    if (!sink || capacity < 2) {
+      overflow = true;
+      return;
+    }
+    flush();
+  }
+  buffer[used++] = c;
+  buffer[used] = '\0';
+}
+
+void JsonWriter::put(const char* text) {
+  while (*text) {
+    put(*text++);
+  }
+}
+
+void JsonWriter::putUnsigned(unsigned long long number) {
+  char digits[20];
+  uint8_t count = 0;
+  do {
+    digits[count++] = (char)('0' + number % 10);
+    number /= 10;
+  } while (number);
+  while (count) {
+    put(digits[--count]);
+  }
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#if defined(ARDUINO)
+#include <Print.h>
+#else
+// The part of Arduino's Print a sink needs, for host builds
+class Print {
+public:
+  virtual ~Print() = default;
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* data, size_t size) {
+    size_t n = 0;
+    while (n < size && write(data[n])) {
+      ++n;
+    }
+    return n;
+  }
+};
+#endif
+
+// Serializes JSON into a caller-provided buffer without touching the heap.
+//
+// Without a sink the buffer holds the whole document, NUL-terminated; output
+// that does not fit is dropped and overflowed() reports it. With a sink, such
+// as an AsyncResponseStream, the buffer is only a staging area handed to the
+// sink whenever it fills up and on flush(), so a small buffer serves
+// documents of any size.
+//
+// Commas are inserted automatically:
+//   json.beginObject().field("columns", 32).key("rows").beginArray()
+//       .value(1).value(2).endArray().endObject();
+class JsonWriter {
+public:
+  // Deepest nesting of objects and arrays whose commas are tracked
+  static constexpr uint8_t MAX_DEPTH = 16;
+
+  JsonWriter(char* buffer, size_t capacity, Print* sink = nullptr);
+
+  JsonWriter& beginObject();
+  JsonWriter& endObject();
+  JsonWriter& beginArray();
+  JsonWriter& endArray();
+  // Member name; the next value belongs to it
+  JsonWriter& key(const char* name);
+
+  // A string literal, escaped; nullptr writes null
+  JsonWriter& value(const char* text);
+  JsonWriter& value(bool flag);
+  JsonWriter& value(int number);
+  JsonWriter& value(unsigned int number);
+  JsonWriter& value(long number);
+  JsonWriter& value(unsigned long number);
+  JsonWriter& value(unsigned long long number);
+  JsonWriter& null();
+
+  template<typename T>
+  JsonWriter& field(const char* name, T v) {
+    return key(name).value(v);
+  }
+
+  // Hand everything buffered so far to the sink
+  void flush();
+
+  // The document so far; only complete when there is no sink
+  const char* c_str() const;
+  size_t length() const;
+  bool overflowed() const;
+
+private:
+  void separate();
+  void open(char bracket);
+  void close(char bracket);
+  void put(char c);
+  void put(const char* text);
+  void putUnsigned(unsigned long long number);
+
+  char* buffer;
+  size_t capacity;
+  Print* sink;
+  size_t used;
+  bool overflow;
+  uint8_t depth;
+  // Bit d is set while the container at depth d has no element yet
+  uint16_t empty;
+  // A key was just written, so its value needs no comma
+  bool afterKey;
+};
@@ -0,0 +1,26 @@
+#if defined(ARDUINO)
+
+#include "BitBangTransport.h"
+
+#include <Arduino.h>
+
+BitBangTransport::BitBangTransport(uint8_t dataPin, uint8_t clockPin, uint8_t csPin)
+: dataPin(dataPin), clockPin(clockPin), csPin(csPin)
+{}
+
+void BitBangTransport::begin() {
+  pinMode(dataPin, OUTPUT);
+  pinMode(clockPin, OUTPUT);
+  pinMode(csPin, OUTPUT);
+  digitalWrite(csPin, HIGH);
+}
+
+void BitBangTransport::transfer(const uint8_t* data, size_t length) {
+  digitalWrite(csPin, LOW);
+  for (size_t i = 0; i < length; ++i) {
+    shiftOut(dataPin, clockPin, MSBFIRST, data[i]);
+  }
+  digitalWrite(csPin, HIGH);
+}
+
+#endif
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "Max7219Transport.h"
+
+// Drives the chain by toggling GPIOs with shiftOut(), like LedControl does.
+class BitBangTransport : public Max7219Transport {
+public:
+  BitBangTransport(uint8_t dataPin, uint8_t clockPin, uint8_t csPin);
+
+  void begin() override;
+  void transfer(const uint8_t* data, size_t length) override;
+
+private:
+  uint8_t dataPin;
+  uint8_t clockPin;
+  uint8_t csPin;
+};
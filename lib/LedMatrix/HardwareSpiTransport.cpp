@@ -0,0 +1,26 @@
+#if defined(ARDUINO)
+
+#include "HardwareSpiTransport.h"
+
+#include <Arduino.h>
+#include <SPI.h>
+
+HardwareSpiTransport::HardwareSpiTransport(uint8_t csPin, uint32_t clockHz)
+: csPin(csPin), clockHz(clockHz)
+{}
+
+void HardwareSpiTransport::begin() {
+  pinMode(csPin, OUTPUT);
+  digitalWrite(csPin, HIGH);
+  SPI.begin();
+}
+
+void HardwareSpiTransport::transfer(const uint8_t* data, size_t length) {
+  SPI.beginTransaction(SPISettings(clockHz, MSBFIRST, SPI_MODE0));
+  digitalWrite(csPin, LOW);
+  SPI.writeBytes(data, length);
+  digitalWrite(csPin, HIGH);
+  SPI.endTransaction();
+}
+
+#endif
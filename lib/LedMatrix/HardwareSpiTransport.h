@@ -0,0 +1,17 @@
+#pragma once
+
+#include "Max7219Transport.h"
+
+// Drives the chain from the hardware SPI peripheral (HSPI on the ESP8266,
+// MOSI on D7 and SCK on D5). CS is toggled manually around each transfer.
+class HardwareSpiTransport : public Max7219Transport {
+public:
+  HardwareSpiTransport(uint8_t csPin, uint32_t clockHz);
+
+  void begin() override;
+  void transfer(const uint8_t* data, size_t length) override;
+
+private:
+  uint8_t csPin;
+  uint32_t clockHz;
+};
@@ -1,27 +1,143 @@
 #include "hardware.h"
 #include "LedMatrix.h"
-#include <LedControl.h>
+#include "Bits.h"
+
+#include <string.h>
+#if defined(ARDUINO)
+#if defined(LED_MATRIX_BITBANG)
+#include "BitBangTransport.h"
+#else
+#include "HardwareSpiTransport.h"
+#endif
+#endif
 
 #define DEFAULT_BRIGHTNESS 0
 
-LedControl lc(PIN_DIN, PIN_CLK, PIN_CS, NUM_DEVICES);
+namespace {
+// Devices are numbered along the chain band by band: device 0 drives the
+// leftmost 8x8 block of rows 0-7, the next one the block to its right, and
+// so on before moving down to rows 8-15.
+constexpr uint8_t DEVICES_PER_BAND = Display::COLUMNS / 8;
+}
+
+static_assert(Display::COLUMNS % 8 == 0, "each device drives 8 columns");
+static_assert(NUM_DEVICES == DEVICES_PER_BAND * Display::BANDS, "NUM_DEVICES must tile the panel with 8x8 blocks");
+
+#if defined(ARDUINO)
+namespace {
+#if defined(LED_MATRIX_BITBANG)
+BitBangTransport defaultTransport(PIN_DIN, PIN_CLK, PIN_CS);
+#else
+HardwareSpiTransport defaultTransport(PIN_CS, LED_MATRIX_SPI_HZ);
+#endif
+}
 
 LedMatrix::LedMatrix()
-: currentIntensity(DEFAULT_BRIGHTNESS)
+: LedMatrix(&defaultTransport)
+{}
+#endif
+
+LedMatrix::LedMatrix(Max7219Transport* transport)
+: chain(transport),
+  currentIntensity(DEFAULT_BRIGHTNESS),
+  digitsPerStep(LED_MATRIX_FLUSH_DIGITS_PER_STEP),
+  pendingDigits(0),
+  mounting(),
+  transformChanged(false),
+  frame{},
+  registers{},
+  pending{}
 {
-  for (uint8_t i = 0; i < NUM_DEVICES; ++i) {
-    lc.shutdown(i, false);
-    lc.setIntensity(i, currentIntensity);
-    lc.clearDisplay(i);
-  }
+  chain.begin(currentIntensity);
 }
 
 void LedMatrix::set(Display* display) {
-  for (uint8_t x = 0; x < LED_MATRIX_COLS; ++x) {
-    for (uint8_t y = 0; y < LED_MATRIX_ROWS; ++y) {
-      lc.setLed(x / 8, x % 8, y, display->getPixel(x, y));
+  while (flushStep()) {}
+  beginFlush(display);
+  while (flushStep()) {}
+}
+
+bool LedMatrix::beginFlush(Display* display) {
+  if (flushing()) {
+    return false;
+  }
+  const bool transformed = !mounting.identity();
+  if (transformed) {
+    // A transform can move any pixel to any device, so the whole frame is
+    // mapped and every device recomputed; unchanged digits are still
+    // skipped below.
+    Display::Row source[Display::ROWS];
+    for (uint8_t y = 0; y < Display::ROWS; ++y) {
+      source[y] = display->rowBits(y);
+    }
+    mounting.apply(source, frame);
+  } else {
+    for (uint8_t y = 0; y < Display::ROWS; ++y) {
+      frame[y] = display->rowBits(y);
+    }
+  }
+  const bool everything = transformed || transformChanged;
+  transformChanged = false;
+  for (uint8_t band = 0; band < Display::BANDS; ++band) {
+    const Display::Row dirty = everything ? Display::FULL_ROW : display->dirtyColumns(band);
+    for (uint8_t block = 0; block < DEVICES_PER_BAND; ++block) {
+      uint8_t deviceDirty = (uint8_t)(dirty >> (block * 8));
+      if (!deviceDirty) {
+        continue;
+      }
+      const uint8_t device = (uint8_t)(band * DEVICES_PER_BAND + block);
+      // Slice this device's 8x8 block out of the row masks and transpose it
+      // so each byte becomes one column, i.e. one digit register.
+      uint8_t rows[8];
+      uint8_t columns[8];
+      for (uint8_t y = 0; y < 8; ++y) {
+        rows[y] = (uint8_t)(frame[band * 8 + y] >> (block * 8));
+      }
+      Bits::transpose8x8(rows, columns);
+      for (uint8_t digit = 0; digit < Max7219::DIGITS; ++digit) {
+        // transpose8x8 treats the most significant bit as column 0, while the
+        // row masks keep column 0 in the least significant bit.
+        uint8_t value = columns[7 - digit];
+        pending[digit][device] = value;
+        if (value != registers[digit][device]) {
+          pendingDigits |= (uint8_t)(1U << digit);
+        }
+      }
+    }
+  }
+  display->refresh();
+  return true;
+}
+
+bool LedMatrix::needsFlush(const Display* display) const {
+  return transformChanged || display->needsRefresh();
+}
+
+bool LedMatrix::flushStep() {
+  uint8_t budget = digitsPerStep;
+  for (uint8_t digit = 0; digit < Max7219::DIGITS && pendingDigits && budget; ++digit) {
+    uint8_t bit = (uint8_t)(1U << digit);
+    if (!(pendingDigits & bit)) {
+      continue;
     }
+    memcpy(registers[digit], pending[digit], NUM_DEVICES);
+    chain.writeDigit(digit, registers[digit]);
+    pendingDigits &= (uint8_t)~bit;
+    --budget;
   }
+  return flushing();
+}
+
+bool LedMatrix::flushing() const {
+  return pendingDigits != 0;
+}
+
+void LedMatrix::setFlushBudget(uint8_t digits) {
+  digitsPerStep = digits == 0 ? 1 : digits;
+}
+
+uint8_t LedMatrix::flushBudget() const {
+  return digitsPerStep;
 }
 
 void LedMatrix::setIntensity(uint8_t value) {
@@ -29,11 +145,18 @@ void LedMatrix::setIntensity(uint8_t value) {
     value = LED_MATRIX_BRIGHTNESS_MAX;
   }
   currentIntensity = value;
-  for (uint8_t i = 0; i < NUM_DEVICES; ++i) {
-    lc.setIntensity(i, currentIntensity);
-  }
+  chain.writeAll(Max7219::REG_INTENSITY, currentIntensity);
 }
 
 uint8_t LedMatrix::intensity() const {
   return currentIntensity;
 }
+
+const Transform& LedMatrix::transform() const {
+  return mounting;
+}
+
+void LedMatrix::setTransform(const Transform& value) {
+  mounting = value;
+  transformChanged = true;
+}
@@ -2,14 +2,61 @@
 
 #include <stdlib.h>
 #include "Display.h"
+#include "hardware.h"
+#include "Max7219.h"
+#include "Max7219Transport.h"
+#include "Transform.h"
 
 class LedMatrix {
 public:
+#if defined(ARDUINO)
+  // Drive the panel's pins; host builds have to pass a transport
   LedMatrix();
+#endif
+  // Drive the chain through a specific transport, e.g. a RecordingTransport
+  explicit LedMatrix(Max7219Transport* transport);
 
+  // Push the columns the display marked dirty and wait until the whole
+  // frame is on the panel.
   void set(Display* display);
+
+  // Snapshot the dirty part of the display and queue the digit registers
+  // that differ from what the devices hold. Register bytes are produced a
+  // device at a time with an 8x8 bit transpose. Returns false while a
+  // previous flush is still in progress; the display keeps its dirty
+  // columns so they go out with the next flush.
+  bool beginFlush(Display* display);
+  // True when beginFlush() has something to send: the display has dirty
+  // columns or the transform changed
+  bool needsFlush(const Display* display) const;
+  // Write at most flushBudget() queued digits (each one a single transaction
+  // for the whole chain). Returns true while digits are still queued.
+  bool flushStep();
+  bool flushing() const;
+
+  void setFlushBudget(uint8_t digits);
+  uint8_t flushBudget() const;
+
   void setIntensity(uint8_t value);
   uint8_t intensity() const;
+
+  // Mapping from the logical frame to the physical panel. It is applied
+  // to the whole frame at the start of the next flush.
+  const Transform& transform() const;
+  void setTransform(const Transform& value);
 private:
+  Max7219 chain;
   uint8_t currentIntensity;
+  uint8_t digitsPerStep;
+  // Digits snapshotted by beginFlush() that have not been written yet
+  uint8_t pendingDigits;
+  Transform mounting;
+  // The transform changed and every device has to be recomputed
+  bool transformChanged;
+  // Frame being flushed as row masks, after the transform
+  Display::Row frame[Display::ROWS];
+  // Last value written to each digit register, indexed by [digit][device]
+  uint8_t registers[Max7219::DIGITS][NUM_DEVICES];
+  // Frame being flushed, in the same layout as registers
+  uint8_t pending[Max7219::DIGITS][NUM_DEVICES];
 };
@@ -0,0 +1,39 @@
+#include "Max7219.h"
+
+Max7219::Max7219(Max7219Transport* transport)
+: transport(transport), frame{}
+{}
+
+void Max7219::begin(uint8_t intensity) {
+  transport->begin();
+  writeAll(REG_DISPLAY_TEST, 0);
+  writeAll(REG_SCAN_LIMIT, DIGITS - 1);
+  writeAll(REG_DECODE_MODE, 0);
+  for (uint8_t digit = 0; digit < DIGITS; ++digit) {
+    writeAll((uint8_t)(REG_DIGIT0 + digit), 0);
+  }
+  writeAll(REG_INTENSITY, intensity);
+  writeAll(REG_SHUTDOWN, 1);
+}
+
+void Max7219::writeAll(uint8_t reg, uint8_t value) {
+  for (uint8_t d = 0; d < NUM_DEVICES; ++d) {
+    frame[d * 2] = reg;
+    frame[d * 2 + 1] = value;
+  }
+  send();
+}
+
+void Max7219::writeDigit(uint8_t digit, const uint8_t* values) {
+  // The first word shifted out ends up in the device farthest from DIN
+  for (uint8_t d = 0; d < NUM_DEVICES; ++d) {
+    uint8_t slot = (uint8_t)(NUM_DEVICES - 1 - d);
+    frame[slot * 2] = (uint8_t)(REG_DIGIT0 + digit);
+    frame[slot * 2 + 1] = values[d];
+  }
+  send();
+}
+
+void Max7219::send() {
+  transport->transfer(frame, sizeof(frame));
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "hardware.h"
+#include "Max7219Transport.h"
+
+// Register-level driver for NUM_DEVICES daisy-chained MAX7219s.
+//
+// Every write builds one frame holding a 16-bit word per device and sends it
+// with a single CS pulse, so updating the same digit on the whole chain costs
+// one transaction instead of one (no-op padded) transaction per device.
+class Max7219 {
+public:
+  static constexpr uint8_t DIGITS = 8;
+
+  enum Register : uint8_t {
+    REG_NOOP = 0x00,
+    REG_DIGIT0 = 0x01,
+    REG_DECODE_MODE = 0x09,
+    REG_INTENSITY = 0x0A,
+    REG_SCAN_LIMIT = 0x0B,
+    REG_SHUTDOWN = 0x0C,
+    REG_DISPLAY_TEST = 0x0F,
+  };
+
+  explicit Max7219(Max7219Transport* transport);
+
+  // Bring the chain into a known state: no decode, all digits scanned,
+  // display test off, digits blank and shutdown released.
+  void begin(uint8_t intensity);
+
+  // Write the same value to one register on every device
+  void writeAll(uint8_t reg, uint8_t value);
+  // Write digit register `digit` (0-7) on every device; values[d] goes to
+  // device d, where device 0 is the one closest to DIN.
+  void writeDigit(uint8_t digit, const uint8_t* values);
+
+private:
+  void send();
+
+  Max7219Transport* transport;
+  uint8_t frame[NUM_DEVICES * 2];
+};
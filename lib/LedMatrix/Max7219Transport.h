@@ -0,0 +1,15 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Moves bytes to a chain of MAX7219 drivers. Each transfer() is framed by a
+// single CS pulse, so every device latches whatever word ended up in its
+// shift register when CS goes high.
+class Max7219Transport {
+public:
+  virtual ~Max7219Transport() = default;
+
+  virtual void begin() = 0;
+  virtual void transfer(const uint8_t* data, size_t length) = 0;
+};
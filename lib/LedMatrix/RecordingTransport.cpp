@@ -0,0 +1,46 @@
+#include "RecordingTransport.h"
+
+RecordingTransport::RecordingTransport()
+: log{}, logged(0), totalBytes(0), transactions(0), started(false)
+{}
+
+void RecordingTransport::begin() {
+  started = true;
+}
+
+void RecordingTransport::transfer(const uint8_t* data, size_t length) {
+  for (size_t i = 0; i < length; ++i) {
+    if (logged < CAPACITY) {
+      log[logged++] = data[i];
+    }
+  }
+  totalBytes += length;
+  ++transactions;
+}
+
+void RecordingTransport::reset() {
+  logged = 0;
+  totalBytes = 0;
+  transactions = 0;
+  started = false;
+}
+
+bool RecordingTransport::begun() const {
+  return started;
+}
+
+const uint8_t* RecordingTransport::bytes() const {
+  return log;
+}
+
+size_t RecordingTransport::byteCount() const {
+  return totalBytes;
+}
+
+size_t RecordingTransport::transactionCount() const {
+  return transactions;
+}
+
+bool RecordingTransport::overflowed() const {
+  return totalBytes > logged;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "Max7219Transport.h"
+
+// Host-side transport that keeps the raw SPI byte stream so native tests can
+// assert exactly what would have gone over the wire.
+class RecordingTransport : public Max7219Transport {
+public:
+  static constexpr size_t CAPACITY = 1024;
+
+  RecordingTransport();
+
+  void begin() override;
+  void transfer(const uint8_t* data, size_t length) override;
+
+  // Forget everything recorded so far, including the begin() flag
+  void reset();
+
+  bool begun() const;
+  const uint8_t* bytes() const;
+  size_t byteCount() const;
+  size_t transactionCount() const;
+  // True if more bytes were sent than CAPACITY could hold
+  bool overflowed() const;
+
+private:
+  uint8_t log[CAPACITY];
+  size_t logged;
+  size_t totalBytes;
+  size_t transactions;
+  bool started;
+};
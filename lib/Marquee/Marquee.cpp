@@ -0,0 +1,117 @@
+#include "Marquee.h"
+
+#include <string.h>
+
+Marquee::Marquee(Display* display, const char* text, unsigned long speed)
+: Visualization(display, TICK_INTERVAL_MS),
+  text{},
+  speed(speed),
+  speedAccumulator(0),
+  strip{},
+  stripWidth(0),
+  offset(0)
+{
+  setText(text);
+}
+
+const char* Marquee::getText() const {
+  return text;
+}
+
+void Marquee::setText(const char* value) {
+  size_t length = 0;
+  if (value) {
+    while (value[length] && length < MAX_TEXT_LENGTH) {
+      text[length] = value[length];
+      ++length;
+    }
+  }
+  text[length] = '\0';
+  renderStrip();
+  offset = 0;
+  render();
+}
+
+unsigned long Marquee::getSpeed() const {
+  return speed;
+}
+
+void Marquee::setSpeed(unsigned long value) {
+  speed = value;
+}
+
+bool Marquee::advance(unsigned long elapsedMs) {
+  if (speed == 0) {
+    return true;
+  }
+  bool moved = false;
+  speedAccumulator += elapsedMs;
+  while (speedAccumulator >= speed) {
+    // Slide until the end of the message has left the left edge, then wrap
+    offset = (uint16_t)(offset + 1);
+    if (offset >= stripWidth) {
+      offset = 0;
+    }
+    speedAccumulator -= speed;
+    moved = true;
+  }
+  if (moved) {
+    render();
+  }
+  return true;
+}
+
+unsigned long Marquee::msUntilChange() const {
+  if (speed == 0) {
+    return (unsigned long)-1;
+  }
+  return speedAccumulator >= speed ? 0 : speed - speedAccumulator;
+}
+
+void Marquee::render() {
+  if (!display) {
+    return;
+  }
+  uint8_t yOffset = 0;
+  if (Display::ROWS > Font4x6::HEIGHT) {
+    yOffset = (uint8_t)((Display::ROWS - Font4x6::HEIGHT) / 2);
+  }
+  for (uint8_t r = 0; r < Font4x6::HEIGHT; ++r) {
+    display->setRow((uint8_t)(yOffset + r), window(r, offset));
+  }
+}
+
+void Marquee::renderStrip() {
+  memset(strip, 0, sizeof(strip));
+  uint16_t x = Display::COLUMNS;
+  for (const char* p = text; *p; ++p) {
+    uint8_t rows[Font4x6::HEIGHT];
+    Font4x6::rowsFor(*p, rows);
+    for (uint8_t r = 0; r < Font4x6::HEIGHT; ++r) {
+      // A glyph row is narrower than 8 bits, so it spans at most two words
+      const uint32_t bits = rows[r];
+      strip[r][x / 32] |= bits << (x % 32);
+      if (x % 32 > 32 - Font4x6::WIDTH && x / 32 + 1 < STRIP_WORDS) {
+        strip[r][x / 32 + 1] |= bits >> (32 - x % 32);
+      }
+    }
+    x = (uint16_t)(x + GLYPH_ADVANCE);
+  }
+  stripWidth = x;
+}
+
+Display::Row Marquee::window(uint8_t row, uint16_t start) const {
+  using Row = Display::Row;
+  Row out = 0;
+  const uint16_t shift = start % 32;
+  for (uint16_t word = start / 32; word < STRIP_WORDS; ++word) {
+    // Column of the display that bit 0 of this word lands on
+    const int16_t position = (int16_t)((word - start / 32) * 32 - shift);
+    if (position >= Display::COLUMNS) {
+      break;
+    }
+    const uint32_t bits = strip[row][word];
+    out |= position >= 0 ? (Row)((Row)bits << position) : (Row)(bits >> -position);
+  }
+  return out & Display::FULL_ROW;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Display.h"
+#include "Font.h"
+#include "Visualization.h"
+
+// Scrolls a message across the panel from right to left.
+//
+// The message is rendered once into an off-screen strip of row bits. Each
+// tick only slides a display-wide window along that strip, so the cost of a
+// frame depends on the font height, not on the number of glyph pixels.
+class Marquee : public Visualization {
+public:
+  static constexpr size_t MAX_TEXT_LENGTH = 64;
+  static constexpr unsigned long TICK_INTERVAL_MS = 10;
+  static constexpr unsigned long DEFAULT_SPEED_MS = 60;
+
+  Marquee(Display* display, const char* text = "HELLO", unsigned long speed = DEFAULT_SPEED_MS);
+
+  const char* getText() const;
+  // Replace the message and restart the scroll. Text longer than
+  // MAX_TEXT_LENGTH is truncated.
+  void setText(const char* value);
+
+  // Milliseconds per one-column step
+  unsigned long getSpeed() const;
+  void setSpeed(unsigned long value);
+
+protected:
+  bool advance(unsigned long elapsedMs) override;
+  void render() override;
+  // The next one-column step; never while paused
+  unsigned long msUntilChange() const override;
+
+private:
+  static constexpr uint16_t GLYPH_ADVANCE = Font4x6::WIDTH + Font4x6::SPACING;
+  // The strip starts with a display-wide gap so the message enters from
+  // the right edge instead of appearing all at once.
+  static constexpr uint16_t STRIP_COLUMNS = Display::COLUMNS + MAX_TEXT_LENGTH * GLYPH_ADVANCE;
+  static constexpr uint16_t STRIP_WORDS = (STRIP_COLUMNS + 31) / 32;
+
+  void renderStrip();
+  Display::Row window(uint8_t row, uint16_t start) const;
+
+  char text[MAX_TEXT_LENGTH + 1];
+  unsigned long speed;
+  unsigned long speedAccumulator;
+  uint32_t strip[Font4x6::HEIGHT][STRIP_WORDS];
+  uint16_t stripWidth;
+  uint16_t offset;
+};
@@ -0,0 +1,212 @@
+#include "Playlist.h"
+
+#include <string.h>
+
+namespace {
+const char* const TRANSITION_NAMES[] = {"none", "wipe", "dissolve", "slide"};
+}
+
+Playlist::Playlist(Display* display, Activator activate)
+: display(display),
+  activate(activate),
+  entries{},
+  entryCount(0),
+  index(0),
+  playing(false),
+  entryStart(0),
+  transition(Transition::WIPE),
+  transitionMs(DEFAULT_TRANSITION_MS),
+  transitioning(false),
+  transitionStart(0),
+  lastProgress(0),
+  random(),
+  outgoing{},
+  revealed{},
+  blended{}
+{}
+
+bool Playlist::add(const VisualizationDefinition* definition, unsigned long durationMs) {
+  if (entryCount >= MAX_ENTRIES || !definition || durationMs == 0) {
+    return false;
+  }
+  entries[entryCount].definition = definition;
+  entries[entryCount].durationMs = durationMs;
+  ++entryCount;
+  return true;
+}
+
+void Playlist::clear() {
+  stop();
+  entryCount = 0;
+  index = 0;
+}
+
+uint8_t Playlist::size() const {
+  return entryCount;
+}
+
+const Playlist::Entry* Playlist::entry(uint8_t index) const {
+  return index < entryCount ? &entries[index] : nullptr;
+}
+
+Playlist::Transition Playlist::getTransition() const {
+  return transition;
+}
+
+unsigned long Playlist::getTransitionDuration() const {
+  return transitionMs;
+}
+
+void Playlist::setTransition(Transition transition, unsigned long durationMs) {
+  this->transition = transition;
+  transitionMs = durationMs > MAX_TRANSITION_MS ? MAX_TRANSITION_MS : durationMs;
+}
+
+const char* Playlist::transitionName(Transition transition) {
+  return TRANSITION_NAMES[(uint8_t)transition];
+}
+
+bool Playlist::parseTransition(const char* name, Transition* transition) {
+  if (!name || !transition) {
+    return false;
+  }
+  for (uint8_t i = 0; i < sizeof(TRANSITION_NAMES) / sizeof(TRANSITION_NAMES[0]); ++i) {
+    if (strcmp(TRANSITION_NAMES[i], name) == 0) {
+      *transition = (Transition)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool Playlist::start(unsigned long now) {
+  if (entryCount == 0) {
+    return false;
+  }
+  playing = true;
+  show(0, now);
+  return true;
+}
+
+void Playlist::stop() {
+  playing = false;
+  transitioning = false;
+}
+
+bool Playlist::running() const {
+  return playing;
+}
+
+uint8_t Playlist::currentIndex() const {
+  return index;
+}
+
+void Playlist::check(unsigned long now) {
+  if (!playing || entryCount == 0) {
+    return;
+  }
+  if (now - entryStart < entries[index].durationMs) {
+    return;
+  }
+  const uint8_t next = (uint8_t)((index + 1) % entryCount);
+  if (entries[next].definition == entries[index].definition) {
+    // A lone entry, or the same visualization twice in a row: keep it
+    // running and just restart the timer
+    index = next;
+    entryStart = now;
+    return;
+  }
+  show(next, now);
+}
+
+bool Playlist::present(unsigned long now, const Display::Row* frame) {
+  if (!display) {
+    return false;
+  }
+  if (transitioning) {
+    const unsigned long elapsed = now - transitionStart;
+    if (elapsed < transitionMs) {
+      blend((uint16_t)(elapsed * 256 / transitionMs), frame);
+      return display->present(blended);
+    }
+    transitioning = false;
+  }
+  return display->present(frame);
+}
+
+unsigned long Playlist::msUntilDue(unsigned long now) const {
+  unsigned long due = (unsigned long)-1;
+  if (transitioning) {
+    due = FRAME_INTERVAL_MS;
+  }
+  if (playing && entryCount > 0) {
+    const unsigned long elapsed = now - entryStart;
+    const unsigned long remaining = elapsed >= entries[index].durationMs ? 0 : entries[index].durationMs - elapsed;
+    if (remaining < due) {
+      due = remaining;
+    }
+  }
+  return due;
+}
+
+void Playlist::show(uint8_t next, unsigned long now) {
+  index = next;
+  entryStart = now;
+  if (transition != Transition::NONE && transitionMs > 0 && display) {
+    // Whatever is on the panel right now becomes the outgoing frame
+    for (uint8_t y = 0; y < Display::ROWS; ++y) {
+      outgoing[y] = display->rowBits(y);
+      revealed[y] = 0;
+    }
+    transitioning = true;
+    transitionStart = now;
+    lastProgress = 0;
+  }
+  if (activate) {
+    activate(entries[index].definition->id);
+  }
+}
+
+void Playlist::blend(uint16_t progress, const Row* incoming) {
+  constexpr uint8_t width = Display::COLUMNS;
+  const uint8_t columns = (uint8_t)(progress * width / 256);
+
+  switch (transition) {
+    case Transition::WIPE: {
+      const Row uncovered = columns == 0 ? 0 : (Row)(Display::FULL_ROW >> (width - columns));
+      for (uint8_t y = 0; y < Display::ROWS; ++y) {
+        blended[y] = (Row)((incoming[y] & uncovered) | (outgoing[y] & (Row)~uncovered));
+      }
+      break;
+    }
+    case Transition::DISSOLVE: {
+      if (progress > lastProgress) {
+        // Reveal just enough of the remaining pixels to reach `progress`
+        const uint16_t remaining = (uint16_t)(256 - lastProgress);
+        const uint8_t percent = (uint8_t)(((progress - lastProgress) * 100U + remaining - 1) / remaining);
+        for (uint8_t y = 0; y < Display::ROWS; ++y) {
+          revealed[y] |= random.maskBits<Row>(percent);
+        }
+        lastProgress = progress;
+      }
+      for (uint8_t y = 0; y < Display::ROWS; ++y) {
+        blended[y] = (Row)((incoming[y] & revealed[y]) | (outgoing[y] & (Row)~revealed[y]));
+      }
+      break;
+    }
+    case Transition::SLIDE: {
+      for (uint8_t y = 0; y < Display::ROWS; ++y) {
+        // Column 0 is the least significant bit, so moving left is a right shift
+        blended[y] = columns == 0 ? outgoing[y]
+                   : (Row)((outgoing[y] >> columns) | (incoming[y] << (width - columns)));
+      }
+      break;
+    }
+    case Transition::NONE:
+    default:
+      for (uint8_t y = 0; y < Display::ROWS; ++y) {
+        blended[y] = incoming[y];
+      }
+      break;
+  }
+}
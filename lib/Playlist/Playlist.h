@@ -0,0 +1,105 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Display.h"
+#include "Random.h"
+#include "Visualizations.h"
+
+// Rotates through a list of visualizations, each shown for its own
+// duration, with an optional transition between consecutive entries.
+//
+// A transition blends a snapshot of the last frame of the outgoing entry
+// with the frame the incoming visualization produces, one row mask at a
+// time, and publishes the result with Display::present(frame). The incoming
+// visualization keeps running and drawing into the back buffer meanwhile.
+class Playlist {
+public:
+  static constexpr uint8_t MAX_ENTRIES = 8;
+  // Transitions are redrawn at this rate
+  static constexpr unsigned long FRAME_INTERVAL_MS = 16;
+  static constexpr unsigned long DEFAULT_TRANSITION_MS = 600;
+  // Longest accepted transition; keeps the progress arithmetic in 32 bits
+  static constexpr unsigned long MAX_TRANSITION_MS = 60000;
+
+  enum class Transition : uint8_t {
+    NONE,
+    // The incoming frame is uncovered from left to right
+    WIPE,
+    // Random pixels switch over until the incoming frame is complete
+    DISSOLVE,
+    // The incoming frame pushes the outgoing one off to the left
+    SLIDE,
+  };
+
+  struct Entry {
+    const VisualizationDefinition* definition;
+    unsigned long durationMs;
+  };
+
+  // Makes a visualization current, e.g. setCurrentVisualizationById
+  using Activator = bool (*)(const char* id);
+
+  Playlist(Display* display, Activator activate);
+
+  // Append an entry; false once MAX_ENTRIES are queued, for an unknown
+  // definition or a zero duration
+  bool add(const VisualizationDefinition* definition, unsigned long durationMs);
+  // Remove every entry and stop
+  void clear();
+  uint8_t size() const;
+  const Entry* entry(uint8_t index) const;
+
+  Transition getTransition() const;
+  unsigned long getTransitionDuration() const;
+  void setTransition(Transition transition, unsigned long durationMs);
+  static const char* transitionName(Transition transition);
+  // Returns false, leaving `transition` alone, for an unknown name
+  static bool parseTransition(const char* name, Transition* transition);
+
+  // Show the first entry now; false if the playlist is empty
+  bool start(unsigned long now);
+  // Stay on the current visualization and cancel any running transition
+  void stop();
+  bool running() const;
+  uint8_t currentIndex() const;
+
+  // Move on to the next entry once the current one's time is up
+  void check(unsigned long now);
+  // Publish `frame` (e.g. the compositor's output), blended with the
+  // outgoing frame while a transition runs. Returns true if the visible
+  // frame changed.
+  bool present(unsigned long now, const Display::Row* frame);
+  // Milliseconds from `now` until check() or present() have new work
+  unsigned long msUntilDue(unsigned long now) const;
+
+private:
+  using Row = Display::Row;
+
+  void show(uint8_t index, unsigned long now);
+  void blend(uint16_t progress, const Row* incoming);
+
+  Display* display;
+  Activator activate;
+
+  Entry entries[MAX_ENTRIES];
+  uint8_t entryCount;
+  uint8_t index;
+  bool playing;
+  unsigned long entryStart;
+
+  Transition transition;
+  unsigned long transitionMs;
+  bool transitioning;
+  unsigned long transitionStart;
+  // Progress of the previous transition frame, out of 256
+  uint16_t lastProgress;
+  Random random;
+
+  // Last frame of the outgoing entry
+  Row outgoing[Display::ROWS];
+  // Pixels already taken from the incoming frame by a dissolve
+  Row revealed[Display::ROWS];
+  Row blended[Display::ROWS];
+};
@@ -0,0 +1,49 @@
+#include "Random.h"
+
+Random::Random(uint32_t seed)
+: initialSeed(0),
+  state(0)
+{
+  this->seed(seed);
+}
+
+void Random::seed(uint32_t value) {
+  initialSeed = value == 0 ? DEFAULT_SEED : value;
+  state = initialSeed;
+}
+
+uint32_t Random::getSeed() const {
+  return initialSeed;
+}
+
+uint32_t Random::next() {
+  uint32_t x = state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  state = x;
+  return x;
+}
+
+uint32_t Random::below(uint32_t bound) {
+  // Multiply-shift range reduction; avoids a division and the low-bit bias
+  // of a modulo.
+  return (uint32_t)(((uint64_t)next() * bound) >> 32);
+}
+
+uint32_t Random::mask(uint8_t percent) {
+  if (percent >= 100) {
+    return 0xFFFFFFFFUL;
+  }
+  // Each bit is set with probability k/128, built by folding random words
+  // together from the least significant bit of k upwards.
+  const uint8_t k = (uint8_t)((percent * 128U + 50) / 100);
+  if (k == 0) {
+    return 0;
+  }
+  uint32_t bits = 0;
+  for (uint8_t i = 0; i < 7; ++i) {
+    bits = ((k >> i) & 1U) ? (bits | next()) : (bits & next());
+  }
+  return bits;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+
+// Small seedable pseudo-random generator (Marsaglia xorshift32).
+//
+// Much cheaper than libc rand() on the ESP8266 and independent per owner,
+// so a visualization seeded with the same value replays the same sequence.
+class Random {
+public:
+  static constexpr uint32_t DEFAULT_SEED = 0x2545F491UL;
+
+  explicit Random(uint32_t seed = DEFAULT_SEED);
+
+  // Restart the sequence. Zero is not a valid xorshift state and is
+  // replaced with DEFAULT_SEED.
+  void seed(uint32_t value);
+  // Seed the sequence was last started from
+  uint32_t getSeed() const;
+
+  uint32_t next();
+  // Uniform value in [0, bound); 0 when bound is 0
+  uint32_t below(uint32_t bound);
+  // 32 random bits, each set with probability percent/100 rounded to the
+  // nearest 1/128
+  uint32_t mask(uint8_t percent);
+
+  // next() and mask() widened to T, e.g. a Display::Row, 32 bits at a time
+  template<typename T>
+  T nextBits() {
+    T bits = 0;
+    for (uint8_t i = 0; i < sizeof(T) * 8; i += 32) {
+      // Two 16-bit shifts keep this well defined when T is only 32 bits wide
+      bits = (T)((bits << 16 << 16) | next());
+    }
+    return bits;
+  }
+
+  template<typename T>
+  T maskBits(uint8_t percent) {
+    T bits = 0;
+    for (uint8_t i = 0; i < sizeof(T) * 8; i += 32) {
+      bits = (T)((bits << 16 << 16) | mask(percent));
+    }
+    return bits;
+  }
+
+private:
+  uint32_t initialSeed;
+  uint32_t state;
+};
@@ -0,0 +1,65 @@
+#include "Scheduler.h"
+
+#include <Arduino.h>
+#if defined(ESP8266)
+#include <coredecls.h> // esp_delay, esp_schedule
+#endif
+
+Scheduler::Scheduler()
+: passStart(0),
+  nextDue(MAX_SLEEP_MS),
+  woken(false),
+  windowStart(0),
+  windowWakeups(0),
+  lastWakeupsPerSecond(0)
+{}
+
+void Scheduler::begin(unsigned long now) {
+  passStart = now;
+  nextDue = MAX_SLEEP_MS;
+  woken = false;
+
+  ++windowWakeups;
+  if (now - windowStart >= 1000) {
+    lastWakeupsPerSecond = windowWakeups;
+    windowWakeups = 0;
+    windowStart = now;
+  }
+}
+
+void Scheduler::dueIn(unsigned long ms) {
+  if (ms < nextDue) {
+    nextDue = ms;
+  }
+}
+
+void Scheduler::sleep() {
+  const unsigned long spent = millis() - passStart;
+  if (woken || spent >= nextDue) {
+    // Let the system tasks run between back-to-back passes
+    yield();
+    return;
+  }
+  const unsigned long ms = nextDue - spent;
+  #if defined(ESP8266)
+    // Suspends loop() and lets the system and Wi-Fi tasks run; returns early
+    // once wake() flips the flag and schedules loop() again.
+    esp_delay(ms, [this]() { return !woken; });
+  #else
+    const unsigned long start = millis();
+    while (!woken && millis() - start < ms) {
+      delay(1);
+    }
+  #endif
+}
+
+void Scheduler::wake() {
+  woken = true;
+  #if defined(ESP8266)
+    esp_schedule();
+  #endif
+}
+
+uint16_t Scheduler::wakeupsPerSecond() const {
+  return lastWakeupsPerSecond;
+}
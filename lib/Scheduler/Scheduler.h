@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdint.h>
+
+// Puts loop() to sleep between deadlines.
+//
+// Each pass of loop() starts with begin(), reports when each of its tasks
+// next needs attention with dueIn(), and ends with sleep(). sleep() waits
+// for the earliest of those deadlines, for MAX_SLEEP_MS at most, or until
+// wake() is called from network callbacks, whichever comes first.
+class Scheduler {
+public:
+  // Upper bound on one sleep, so nothing can stall loop() indefinitely
+  static constexpr unsigned long MAX_SLEEP_MS = 1000;
+
+  Scheduler();
+
+  // Start a pass of loop() at `now`
+  void begin(unsigned long now);
+  // Something needs to run `ms` milliseconds after the pass started; 0
+  // means the next pass should follow immediately
+  void dueIn(unsigned long ms);
+  // Sleep until the earliest deadline reported since begin()
+  void sleep();
+
+  // End the current or next sleep early. Safe to call from the network
+  // stack's callbacks.
+  void wake();
+
+  // Passes of loop() counted over the last complete second
+  uint16_t wakeupsPerSecond() const;
+
+private:
+  unsigned long passStart;
+  unsigned long nextDue;
+  volatile bool woken;
+
+  unsigned long windowStart;
+  uint16_t windowWakeups;
+  uint16_t lastWakeupsPerSecond;
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+// Lock-free triple buffer: one context writes whole copies of a value, another
+// reads the newest complete one.
+//
+// The writer (loop()) fills the slot edit() returns and hands it over with
+// publish(); the reader (the async web handlers, which all run in the
+// network stack's context) gets the most recently published copy from
+// read(). Of the three slots the writer owns one, the reader owns one and
+// the third is exchanged between them, so neither side ever waits or sees a
+// half-written copy. Copies published in between two read() calls are
+// skipped.
+template<typename T>
+class Snapshot {
+public:
+  Snapshot() : slots{}, back(0), front(1), middle(2) {}
+
+  // The writer's slot. It may hold an older copy, so fill in all of it.
+  T& edit() {
+    return slots[back];
+  }
+
+  // Make the copy in edit() the newest one
+  void publish() {
+    back = (uint8_t)(middle.exchange((uint8_t)(back | FRESH), std::memory_order_acq_rel) & INDEX);
+  }
+
+  // The newest published copy; stays valid until the reader calls read()
+  // again
+  const T& read() {
+    if (middle.load(std::memory_order_relaxed) & FRESH) {
+      front = (uint8_t)(middle.exchange(front, std::memory_order_acq_rel) & INDEX);
+    }
+    return slots[front];
+  }
+
+private:
+  static constexpr uint8_t INDEX = 0x03;
+  // Set in `middle` while it holds a copy the reader has not taken yet
+  static constexpr uint8_t FRESH = 0x04;
+
+  T slots[3];
+  // Only touched by the writer
+  uint8_t back;
+  // Only touched by the reader
+  uint8_t front;
+  std::atomic<uint8_t> middle;
+};
@@ -1,10 +1,17 @@
 #include "Snow.h"
 
-#include <stdlib.h>
-#include <vector>
+#include "Bits.h"
 
 namespace {
 constexpr uint8_t MAX_WIND_PERCENT = 100;
+
+// Time until an accumulator reaches its rate; never for a rate of zero
+unsigned long untilStep(unsigned long rate, unsigned long accumulator) {
+  if (rate == 0) {
+    return (unsigned long)-1;
+  }
+  return accumulator >= rate ? 0 : rate - accumulator;
+}
 }
 
 Snow::Snow(Display* display,
@@ -20,6 +27,7 @@ Snow::Snow(Display* display,
   gravityAccumulator(0),
   snowAccumulator(0),
   meltAccumulator(0),
+  random(),
   snowRows{}
 {
   snowRows.fill(0);
@@ -28,27 +36,21 @@ Snow::Snow(Display* display,
   }
 }
 
-bool Snow::handlePixelChange(uint8_t x, uint8_t y, bool on) {
+bool Snow::handlePixelChange(const PixelChange* changes, size_t count) {
   if (!display) {
     return false;
   }
-  if (x >= display->width() || y >= display->height()) {
-    return false;
-  }
-  uint32_t mask = (1UL << x);
-  uint32_t& row = snowRows[y];
-  bool alreadyOn = (row & mask) != 0;
   bool stateChanged = false;
-  if (on) {
-    if (!alreadyOn) {
-      row |= mask;
-      stateChanged = true;
-    }
-  } else {
-    if (alreadyOn) {
-      row &= ~mask;
-      stateChanged = true;
+  for (size_t i = 0; i < count; ++i) {
+    const PixelChange& change = changes[i];
+    if (change.y >= Display::ROWS) {
+      continue;
     }
+    const Row mask = change.mask & Display::FULL_ROW;
+    Row& row = snowRows[change.y];
+    const Row next = (Row)((row & (Row)~mask) | (change.bits & mask));
+    stateChanged = stateChanged || next != row;
+    row = next;
   }
   if (stateChanged) {
     render();
@@ -93,8 +95,15 @@ void Snow::setWind(uint8_t value) {
   wind = value > MAX_WIND_PERCENT ? MAX_WIND_PERCENT : value;
 }
 
-bool Snow::run() {
-  const unsigned long elapsed = TICK_INTERVAL_MS;
+uint32_t Snow::getSeed() const {
+  return random.getSeed();
+}
+
+void Snow::setSeed(uint32_t value) {
+  random.seed(value);
+}
+
+bool Snow::advance(unsigned long elapsed) {
   bool changed = false;
 
   if (snowRate > 0) {
@@ -136,22 +145,22 @@ bool Snow::run() {
   return true;
 }
 
+unsigned long Snow::msUntilChange() const {
+  unsigned long until = untilStep(gravity, gravityAccumulator);
+  const unsigned long spawn = untilStep(snowRate, snowAccumulator);
+  const unsigned long melt = untilStep(meltRate, meltAccumulator);
+  if (spawn < until) {
+    until = spawn;
+  }
+  return melt < until ? melt : until;
+}
+
 void Snow::render() {
   if (!display) {
     return;
   }
-  display->clear();
-  for (uint8_t y = 0; y < display->height() && y < LED_MATRIX_ROWS; ++y) {
-    uint32_t row = snowRows[y];
-    if (!row) {
-      continue;
-    }
-    uint8_t width = display->width();
-    for (uint8_t x = 0; x < width && x < LED_MATRIX_COLS; ++x) {
-      if ((row >> x) & 0x01U) {
-        display->setPixel(x, y, true);
-      }
-    }
+  for (uint8_t y = 0; y < Display::ROWS; ++y) {
+    display->setRow(y, snowRows[y]);
   }
 }
 
@@ -159,25 +168,21 @@ bool Snow::addSnowflake() {
   if (!display) {
     return false;
   }
-  const uint8_t width = display->width();
-  if (width == 0) {
-    return false;
-  }
-  uint32_t filledMask = fullRowMask(width);
-  if ((snowRows[0] & filledMask) == filledMask) {
+  constexpr uint8_t width = Display::COLUMNS;
+  if ((snowRows[0] & Display::FULL_ROW) == Display::FULL_ROW) {
     return false;
   }
   const uint8_t attempts = width;
   for (uint8_t i = 0; i < attempts; ++i) {
-    uint8_t x = (uint8_t)(rand() % width);
-    uint32_t mask = (1UL << x);
+    uint8_t x = (uint8_t)random.below(width);
+    const Row mask = Display::bit(x);
     if ((snowRows[0] & mask) == 0) {
       snowRows[0] |= mask;
       return true;
     }
   }
   for (uint8_t x = 0; x < width; ++x) {
-    uint32_t mask = (1UL << x);
+    const Row mask = Display::bit(x);
     if ((snowRows[0] & mask) == 0) {
       snowRows[0] |= mask;
       return true;
@@ -190,141 +195,97 @@ bool Snow::meltSnowflake() {
   if (!display) {
     return false;
   }
-  const uint8_t width = display->width();
-  const uint8_t height = display->height();
-  if (width == 0 || height == 0) {
-    return false;
+  constexpr uint8_t height = Display::ROWS;
+
+  // A flake can melt when it rests on something (the floor or another
+  // flake) and nothing lies on top of it. Candidates are counted row by
+  // row in the same order the old per-pixel scan produced them.
+  uint16_t candidateCount = 0;
+  for (uint8_t y = 0; y < height; ++y) {
+    candidateCount += Bits::popcount(meltCandidates(y));
   }
 
-  std::vector<uint16_t> candidates;
-  candidates.reserve(width * height);
-
-  for (uint8_t y = 0; y < height && y < LED_MATRIX_ROWS; ++y) {
-    uint32_t row = snowRows[y];
-    if (row == 0) {
-      continue;
-    }
-    uint32_t belowRow = (y + 1 < height && (y + 1) < LED_MATRIX_ROWS) ? snowRows[y + 1] : 0;
-    for (uint8_t x = 0; x < width && x < LED_MATRIX_COLS; ++x) {
-      uint32_t mask = (1UL << x);
-      if ((row & mask) == 0) {
-        continue;
-      }
-      bool supported = (y == height - 1) || ((belowRow & mask) != 0);
-      if (!supported) {
-        continue;
-      }
-      bool exposedAbove = (y == 0) || ((snowRows[y - 1] & mask) == 0);
-      if (!exposedAbove) {
-        continue;
+  if (candidateCount == 0) {
+    // Fallback: remove any snow pixel starting from the highest row
+    for (uint8_t y = 0; y < height; ++y) {
+      Row row = snowRows[y];
+      if (row) {
+        snowRows[y] = (Row)(row & (row - 1));
+        return true;
       }
-      candidates.push_back((uint16_t)((y << 8) | x));
     }
+    return false;
   }
 
-  if (candidates.empty()) {
-    // Fallback: remove any snow pixel starting from the highest row
-    for (uint8_t y = 0; y < height && y < LED_MATRIX_ROWS; ++y) {
-      uint32_t row = snowRows[y];
-      if (!row) {
-        continue;
-      }
-      for (uint8_t x = 0; x < width && x < LED_MATRIX_COLS; ++x) {
-        uint32_t mask = (1UL << x);
-        if (row & mask) {
-          snowRows[y] &= ~mask;
-          return true;
-        }
-      }
+  uint16_t choice = (uint16_t)random.below(candidateCount);
+  for (uint8_t y = 0; y < height; ++y) {
+    Row candidates = meltCandidates(y);
+    uint8_t count = Bits::popcount(candidates);
+    if (choice < count) {
+      snowRows[y] &= (Row)~Bits::nthSetBit(candidates, (uint8_t)choice);
+      return true;
     }
-    return false;
+    choice = (uint16_t)(choice - count);
   }
+  return false;
+}
 
-  uint16_t choice = candidates[(size_t)(rand() % candidates.size())];
-  uint8_t y = (uint8_t)(choice >> 8);
-  uint8_t x = (uint8_t)(choice & 0xFF);
-  snowRows[y] &= ~(1UL << x);
-  return true;
+Snow::Row Snow::meltCandidates(uint8_t y) const {
+  constexpr uint8_t height = Display::ROWS;
+  const Row supported = (y == height - 1) ? Display::FULL_ROW : snowRows[y + 1];
+  const Row exposed = (y == 0) ? Display::FULL_ROW : (Row)~snowRows[y - 1];
+  return (Row)(snowRows[y] & supported & exposed);
 }
 
 bool Snow::applyGravityAndWind() {
-  std::array<uint32_t, LED_MATRIX_ROWS> nextRows{};
+  // Whole rows move at once, from the bottom up. A flake falls if the cell
+  // below is free both before and after this step. Flakes picked by the
+  // wind try the diagonal below instead (straight fallers claim their
+  // cells first, then right movers, then left movers) and fall straight or
+  // stay put if that is taken.
+  constexpr Row LEFT_EDGE = Display::bit(0);
+  constexpr Row RIGHT_EDGE = Display::bit(Display::COLUMNS - 1);
+
+  Rows nextRows{};
   nextRows.fill(0);
   bool changed = false;
 
-  const uint8_t width = display ? display->width() : LED_MATRIX_COLS;
-  const uint8_t height = display ? display->height() : LED_MATRIX_ROWS;
+  // The bottom row has already settled
+  nextRows[Display::ROWS - 1] = snowRows[Display::ROWS - 1];
 
-  for (int y = height - 1; y >= 0; --y) {
-    uint32_t row = snowRows[(size_t)y];
+  for (int y = Display::ROWS - 2; y >= 0; --y) {
+    const Row row = snowRows[(size_t)y];
     if (row == 0) {
       continue;
     }
-    for (uint8_t x = 0; x < width && x < LED_MATRIX_COLS; ++x) {
-      uint32_t mask = (1UL << x);
-      if ((row & mask) == 0) {
-        continue;
-      }
-
-      uint8_t destX = x;
-      uint8_t destY = (uint8_t)y;
-
-      auto occupied = [&](uint8_t checkX, uint8_t checkY) -> bool {
-        uint32_t bit = (1UL << checkX);
-        return ((snowRows[(size_t)checkY] | nextRows[(size_t)checkY]) & bit) != 0;
-      };
-
-      if (y < height - 1) {
-        uint8_t nextY = (uint8_t)(y + 1);
-        if (!occupied(destX, nextY)) {
-          destY = nextY;
-          if (wind > 0) {
-            uint8_t roll = (uint8_t)(rand() % 100);
-            if (roll < wind) {
-              bool moveRight = (rand() & 1) != 0;
-              int candidateX = (int)destX + (moveRight ? 1 : -1);
-              if (candidateX >= 0 && candidateX < width) {
-                uint8_t cx = (uint8_t)candidateX;
-                if (!occupied(cx, nextY)) {
-                  destX = cx;
-                }
-              }
-            }
-          }
-        } else if (wind > 0) {
-          uint8_t roll = (uint8_t)(rand() % 100);
-          if (roll < wind) {
-            bool moveRight = (rand() & 1) != 0;
-            int candidateX = (int)x + (moveRight ? 1 : -1);
-            if (candidateX >= 0 && candidateX < width) {
-              uint8_t cx = (uint8_t)candidateX;
-              if (!occupied(cx, nextY)) {
-                destX = cx;
-                destY = nextY;
-              }
-            }
-          }
-        }
-      }
-
-      if (destX != x || destY != y) {
-        changed = true;
-      }
-      nextRows[(size_t)destY] |= (1UL << destX);
+    const Row occupied = snowRows[(size_t)y + 1] | nextRows[(size_t)y + 1];
+    const Row falling = row & (Row)~occupied;
+
+    Row windy = 0;
+    Row toRight = 0;
+    if (wind > 0) {
+      windy = row & random.maskBits<Row>(wind);
+      toRight = random.nextBits<Row>();
     }
+
+    const Row straight = falling & (Row)~windy;
+    Row taken = occupied | straight;
+    const Row rightTargets = (Row)((windy & toRight & (Row)~RIGHT_EDGE) << 1) & (Row)~taken;
+    taken |= rightTargets;
+    const Row leftTargets = (Row)((windy & (Row)~toRight & (Row)~LEFT_EDGE) >> 1) & (Row)~taken;
+    taken |= leftTargets;
+    const Row drifted = (Row)(rightTargets >> 1) | (Row)(leftTargets << 1);
+
+    // Windy flakes that could not drift fall straight if nothing took the
+    // cell below them in the meantime
+    const Row windyStraight = windy & falling & (Row)~drifted & (Row)~taken;
+    const Row moved = straight | drifted | windyStraight;
+
+    nextRows[(size_t)y + 1] |= straight | windyStraight | rightTargets | leftTargets;
+    nextRows[(size_t)y] |= row & (Row)~moved;
+    changed = changed || moved != 0;
   }
 
   snowRows = nextRows;
   return changed;
 }
-
-uint32_t Snow::fullRowMask(uint8_t width) const {
-  if (width >= 32) {
-    return 0xFFFFFFFFUL;
-  }
-  uint32_t mask = 0;
-  for (uint8_t x = 0; x < width; ++x) {
-    mask |= (1UL << x);
-  }
-  return mask;
-}
@@ -4,7 +4,8 @@
 #include <stdint.h>
 
 #include "Visualization.h"
-#include "hardware.h"
+#include "Display.h"
+#include "Random.h"
 
 class Snow : public Visualization {
 public:
@@ -20,7 +21,8 @@ public:
        unsigned long meltRate = DEFAULT_MELT_RATE_MS,
        uint8_t wind = DEFAULT_WIND_PERCENT);
 
-  bool handlePixelChange(uint8_t x, uint8_t y, bool on) override;
+  using Visualization::handlePixelChange;
+  bool handlePixelChange(const PixelChange* changes, size_t count) override;
 
   unsigned long getGravity() const;
   void setGravity(unsigned long value);
@@ -34,16 +36,26 @@ public:
   uint8_t getWind() const;
   void setWind(uint8_t value);
 
+  // Reseeding restarts the random sequence, so the same seed and starting
+  // state replay the same frames.
+  uint32_t getSeed() const;
+  void setSeed(uint32_t value);
+
 protected:
-  bool run() override;
+  bool advance(unsigned long elapsedMs) override;
   void render() override;
+  // The nearest of the next fall, spawn and melt step
+  unsigned long msUntilChange() const override;
 
 private:
+  using Row = Display::Row;
+  using Rows = std::array<Row, Display::ROWS>;
+
   bool addSnowflake();
   bool meltSnowflake();
   bool applyGravityAndWind();
-
-  uint32_t fullRowMask(uint8_t width) const;
+  // Flakes in row y that rest on something and have nothing on top
+  Row meltCandidates(uint8_t y) const;
 
   unsigned long gravity;
   unsigned long snowRate;
@@ -54,5 +66,6 @@ private:
   unsigned long snowAccumulator;
   unsigned long meltAccumulator;
 
-  std::array<uint32_t, LED_MATRIX_ROWS> snowRows;
+  Random random;
+  Rows snowRows;
 };
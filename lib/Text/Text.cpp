@@ -25,19 +25,9 @@ void Text::render() {
     if (x + Font4x6::WIDTH > maxWidth) {
       break; // stop if no space for the next glyph
     }
-    Font4x6::Glyph g = Font4x6::glyphFor(*p);
-    for (uint8_t cx = 0; cx < Font4x6::WIDTH; ++cx) {
-      uint8_t col = g.cols[cx];
-      for (uint8_t ry = 0; ry < Font4x6::HEIGHT; ++ry) {
-        bool on = (col >> ry) & 0x01;
-        if (on) {
-          uint8_t y = (uint8_t)(yOffset + ry);
-          if (y < maxHeight) {
-            this->display->setPixel(x + cx, y, true);
-          }
-        }
-      }
-    }
+    uint8_t rows[Font4x6::HEIGHT];
+    Font4x6::rowsFor(*p, rows);
+    this->display->blit(x, yOffset, rows, Font4x6::WIDTH, Font4x6::HEIGHT, RasterOp::OR);
     x += (Font4x6::WIDTH + Font4x6::SPACING);
     if (x >= maxWidth) {
       break;
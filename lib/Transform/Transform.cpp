@@ -0,0 +1,158 @@
+#include "Transform.h"
+
+#include "Bits.h"
+
+namespace {
+constexpr uint8_t ROW_BITS = sizeof(Display::Row) * 8;
+
+uint8_t wrap(int16_t value, uint8_t size) {
+  int16_t reduced = (int16_t)(value % size);
+  return (uint8_t)(reduced < 0 ? reduced + size : reduced);
+}
+}
+
+Transform::Transform()
+: rotation(Rotation::R0),
+  mirror(false),
+  flip(false),
+  invert(false),
+  offsetX(0),
+  offsetY(0)
+{}
+
+Transform::Rotation Transform::getRotation() const {
+  return rotation;
+}
+
+bool Transform::setRotation(Rotation value) {
+  if (!QUARTER_TURNS && (value == Rotation::R90 || value == Rotation::R270)) {
+    return false;
+  }
+  rotation = value;
+  return true;
+}
+
+uint16_t Transform::degrees(Rotation rotation) {
+  return (uint16_t)((uint8_t)rotation * 90);
+}
+
+bool Transform::fromDegrees(long degrees, Rotation* rotation) {
+  if (!rotation || degrees < 0 || degrees > 270 || degrees % 90 != 0) {
+    return false;
+  }
+  *rotation = (Rotation)(degrees / 90);
+  return true;
+}
+
+bool Transform::getMirror() const {
+  return mirror;
+}
+
+void Transform::setMirror(bool value) {
+  mirror = value;
+}
+
+bool Transform::getFlip() const {
+  return flip;
+}
+
+void Transform::setFlip(bool value) {
+  flip = value;
+}
+
+bool Transform::getInvert() const {
+  return invert;
+}
+
+void Transform::setInvert(bool value) {
+  invert = value;
+}
+
+int16_t Transform::getOffsetX() const {
+  return offsetX;
+}
+
+int16_t Transform::getOffsetY() const {
+  return offsetY;
+}
+
+void Transform::setOffset(int16_t dx, int16_t dy) {
+  offsetX = wrap(dx, Display::COLUMNS);
+  offsetY = wrap(dy, Display::ROWS);
+}
+
+bool Transform::identity() const {
+  return rotation == Rotation::R0 && !mirror && !flip && !invert && offsetX == 0 && offsetY == 0;
+}
+
+void Transform::apply(const Row* in, Row* out) const {
+  Row transposed[Display::ROWS];
+  const Row* source = in;
+  bool mirrorRows = mirror;
+  bool flipRows = flip;
+  switch (rotation) {
+    case Rotation::R90:
+      // Clockwise: transpose, then mirror
+      transpose(in, transposed);
+      source = transposed;
+      mirrorRows = !mirrorRows;
+      break;
+    case Rotation::R180:
+      mirrorRows = !mirrorRows;
+      flipRows = !flipRows;
+      break;
+    case Rotation::R270:
+      // Counter-clockwise: transpose, then flip
+      transpose(in, transposed);
+      source = transposed;
+      flipRows = !flipRows;
+      break;
+    case Rotation::R0:
+    default:
+      break;
+  }
+
+  for (uint8_t y = 0; y < Display::ROWS; ++y) {
+    uint8_t sourceY = (uint8_t)((y + Display::ROWS - offsetY) % Display::ROWS);
+    if (flipRows) {
+      sourceY = (uint8_t)(Display::ROWS - 1 - sourceY);
+    }
+    Row row = source[sourceY];
+    if (mirrorRows) {
+      row = (Row)(Bits::reverse(row) >> (ROW_BITS - Display::COLUMNS));
+    }
+    if (offsetX) {
+      row = (Row)((row << offsetX) | (row >> (Display::COLUMNS - offsetX)));
+    }
+    if (invert) {
+      row = (Row)~row;
+    }
+    out[y] = (Row)(row & Display::FULL_ROW);
+  }
+}
+
+void Transform::transpose(const Row* in, Row* out) {
+  if (!QUARTER_TURNS) {
+    return;
+  }
+  constexpr uint8_t blocks = Display::ROWS / 8;
+  for (uint8_t y = 0; y < Display::ROWS; ++y) {
+    out[y] = 0;
+  }
+  for (uint8_t blockRow = 0; blockRow < blocks; ++blockRow) {
+    for (uint8_t blockColumn = 0; blockColumn < blocks; ++blockColumn) {
+      // transpose8x8 keeps column 0 in the most significant bit while row
+      // masks keep it in bit 0; feeding the rows bottom-up makes the two
+      // conventions line up, so out[7 - j] comes back as column j.
+      uint8_t rows[8];
+      uint8_t columns[8];
+      for (uint8_t i = 0; i < 8; ++i) {
+        rows[i] = (uint8_t)(in[blockRow * 8 + 7 - i] >> (blockColumn * 8));
+      }
+      Bits::transpose8x8(rows, columns);
+      for (uint8_t j = 0; j < 8; ++j) {
+        out[blockColumn * 8 + j] |= (Row)((Row)columns[7 - j] << (blockRow * 8));
+      }
+    }
+  }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "Display.h"
+
+// Maps the logical frame onto the physical panel for different mountings.
+//
+// Applied to whole row masks on the way from Display to LedMatrix, in this
+// order: rotation, mirror (left/right), flip (top/bottom), offset (with
+// wrap-around) and inversion. Mirroring is a word bit-reverse per row,
+// flipping reverses the row order and quarter turns transpose the frame in
+// 8x8 blocks, so they are only available on square panels.
+class Transform {
+public:
+  enum class Rotation : uint8_t {
+    R0,
+    R90,
+    R180,
+    R270,
+  };
+
+  static constexpr bool QUARTER_TURNS = Display::COLUMNS == Display::ROWS;
+
+  Transform();
+
+  Rotation getRotation() const;
+  // Returns false, leaving the rotation alone, for a quarter turn on a
+  // panel that is not square
+  bool setRotation(Rotation value);
+  // Degrees clockwise, 0/90/180/270
+  static uint16_t degrees(Rotation rotation);
+  static bool fromDegrees(long degrees, Rotation* rotation);
+
+  bool getMirror() const;
+  void setMirror(bool value);
+  bool getFlip() const;
+  void setFlip(bool value);
+  bool getInvert() const;
+  void setInvert(bool value);
+
+  // Move the picture right by dx columns and down by dy rows, wrapping
+  // around the edges. Values are reduced modulo the panel size.
+  int16_t getOffsetX() const;
+  int16_t getOffsetY() const;
+  void setOffset(int16_t dx, int16_t dy);
+
+  // True when apply() would copy the frame unchanged
+  bool identity() const;
+
+  // Transform Display::ROWS rows from `in` into `out`; they must not overlap
+  void apply(const Display::Row* in, Display::Row* out) const;
+
+private:
+  using Row = Display::Row;
+
+  static void transpose(const Row* in, Row* out);
+
+  Rotation rotation;
+  bool mirror;
+  bool flip;
+  bool invert;
+  uint8_t offsetX;
+  uint8_t offsetY;
+};
@@ -3,7 +3,7 @@
 StaticVisualization::StaticVisualization(Display* display)
 : Visualization(display, UINT32_MAX) {}
 
-bool StaticVisualization::run() {
+bool StaticVisualization::advance(unsigned long) {
     this->render();
     return true;
 }
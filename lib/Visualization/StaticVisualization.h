@@ -8,5 +8,5 @@ public:
   StaticVisualization(Display* display);
 
 protected:
-  virtual bool run() override;
+  virtual bool advance(unsigned long elapsedMs) override;
 };
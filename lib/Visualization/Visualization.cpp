@@ -1,8 +1,78 @@
 #include "Visualization.h"
 
 Visualization::Visualization(Display* display, unsigned long interval)
-: PeriodicAction(interval), display(display) {}
+: PeriodicAction(interval),
+  display(display),
+  tickInterval(interval),
+  checkTime(0),
+  lastAdvance(0),
+  advanced(false)
+{}
 
-bool Visualization::handlePixelChange(uint8_t, uint8_t, bool) {
+void Visualization::check(unsigned long now) {
+  checkTime = now;
+  if (!advanced || now - lastAdvance >= nextTickAfter()) {
+    run();
+  }
+}
+
+unsigned long Visualization::msUntilDue(unsigned long now) const {
+  if (!advanced) {
+    return 0;
+  }
+  const unsigned long after = nextTickAfter();
+  if (after == (unsigned long)-1) {
+    return after;
+  }
+  const unsigned long elapsed = now - lastAdvance;
+  return elapsed >= after ? 0 : after - elapsed;
+}
+
+unsigned long Visualization::msUntilChange() const {
+  return 0;
+}
+
+unsigned long Visualization::nextTickAfter() const {
+  const unsigned long untilChange = msUntilChange();
+  return untilChange > tickInterval ? untilChange : tickInterval;
+}
+
+bool Visualization::run() {
+  unsigned long elapsed = advanced ? checkTime - lastAdvance : tickInterval;
+  // A tick that was scheduled late on purpose is not a catch-up
+  const unsigned long after = nextTickAfter();
+  const unsigned long cap = after > MAX_CATCH_UP_MS ? after : MAX_CATCH_UP_MS;
+  if (elapsed > cap) {
+    elapsed = cap;
+  }
+  lastAdvance = checkTime;
+  advanced = true;
+  return advance(elapsed);
+}
+
+void Visualization::suspend() {
+  onSuspend();
+}
+
+void Visualization::resume() {
+  advanced = false;
+  onResume();
+}
+
+void Visualization::onSuspend() {}
+
+void Visualization::onResume() {
+  render();
+}
+
+bool Visualization::handlePixelChange(const PixelChange*, size_t) {
   return false;
 }
+
+bool Visualization::handlePixelChange(uint8_t x, uint8_t y, bool on) {
+  if (x >= Display::COLUMNS) {
+    return false;
+  }
+  const PixelChange change = {y, Display::bit(x), on ? Display::bit(x) : (Display::Row)0};
+  return handlePixelChange(&change, 1);
+}
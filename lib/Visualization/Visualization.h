@@ -1,18 +1,74 @@
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 #include <PeriodicAction.h>
 #include "Display.h"
 
+// An edit to one row: the pixels set in `mask` take the values of the
+// matching bits in `bits`. A batch holds at most one change per row.
+struct PixelChange {
+  uint8_t y;
+  Display::Row mask;
+  Display::Row bits;
+};
+
 class Visualization : public PeriodicAction {
 public:
+  // Most time a single tick catches up on after loop() was held up, unless
+  // the visualization's own interval is longer
+  static constexpr unsigned long MAX_CATCH_UP_MS = 250;
+
   Visualization(Display* display, unsigned long interval);
   virtual ~Visualization() = default;
 
-  virtual bool handlePixelChange(uint8_t x, uint8_t y, bool on);
+  // Hides PeriodicAction::check(): runs the tick when the interval, or the
+  // longer msUntilChange(), has passed since the previous one (or on the
+  // first call) and records when it happened, so advance() can be told how
+  // much time really passed.
+  void check(unsigned long now);
+  // Milliseconds from `now` until check() will next do any work
+  unsigned long msUntilDue(unsigned long now) const;
+
+  // Apply pixel edits made from outside, e.g. over the web, all at once so
+  // the visualization redraws only once. Returns false if it does not take
+  // pixel input, in which case the caller edits the display directly.
+  virtual bool handlePixelChange(const PixelChange* changes, size_t count);
+  bool handlePixelChange(uint8_t x, uint8_t y, bool on);
+
+  // Called when the visualization stops being the active one but stays
+  // resident, and when it becomes active again. Time spent suspended is not
+  // caught up on: the first tick after resume() advances by one interval.
+  void suspend();
+  void resume();
 
 protected:
+  // Hooks for suspend() and resume(). The default resume redraws the
+  // current state, since the display was cleared while suspended.
+  virtual void onSuspend();
+  virtual void onResume();
+
+  // Move the animation forward by elapsedMs of real time since the previous
+  // tick (one interval on the first tick), capped at
+  // max(interval, msUntilChange(), MAX_CATCH_UP_MS).
+  virtual bool advance(unsigned long elapsedMs) = 0;
   virtual void render() = 0;
+  // Milliseconds of elapsed time advance() has to be given, counted from
+  // the previous tick, before it changes anything; (unsigned long)-1 if it
+  // never will. Ticks are spaced by this, but never closer than the
+  // interval. The default ticks once per interval.
+  virtual unsigned long msUntilChange() const;
+
+  bool run() final;
 
   Display* display;
+
+private:
+  // Milliseconds between the previous tick and the next one
+  unsigned long nextTickAfter() const;
+
+  unsigned long tickInterval;
+  unsigned long checkTime;
+  unsigned long lastAdvance;
+  bool advanced;
 };
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "Clock.h"
+#include "Columns.h"
+#include "Marquee.h"
+#include "Snow.h"
+#include "Text.h"
+
+namespace VisualizationStorageDetail {
+
+template<typename T>
+constexpr size_t largest() {
+  return sizeof(T);
+}
+
+template<typename T, typename U, typename... Rest>
+constexpr size_t largest() {
+  return sizeof(T) > largest<U, Rest...>() ? sizeof(T) : largest<U, Rest...>();
+}
+
+template<typename T>
+constexpr size_t strictest() {
+  return alignof(T);
+}
+
+template<typename T, typename U, typename... Rest>
+constexpr size_t strictest() {
+  return alignof(T) > strictest<U, Rest...>() ? alignof(T) : strictest<U, Rest...>();
+}
+
+}  // namespace VisualizationStorageDetail
+
+// Every type a VisualizationDefinition can construct must be listed here
+constexpr size_t VISUALIZATION_STORAGE_SIZE = VisualizationStorageDetail::largest<Clock, Columns, Marquee, Snow, Text>();
+constexpr size_t VISUALIZATION_STORAGE_ALIGN = VisualizationStorageDetail::strictest<Clock, Columns, Marquee, Snow, Text>();
+
+// Raw memory any registered visualization can be constructed into
+struct VisualizationStorage {
+  alignas(VISUALIZATION_STORAGE_ALIGN) unsigned char bytes[VISUALIZATION_STORAGE_SIZE];
+};
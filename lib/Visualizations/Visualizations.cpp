@@ -1,35 +1,160 @@
 #include "Visualizations.h"
 
+#include <new>
 #include <string.h>
 
 #include "Clock.h"
 #include "Columns.h"
+#include "Marquee.h"
 #include "Snow.h"
 #include "Text.h"
+#include "Visualization.h"
+#include "VisualizationStorage.h"
 
 namespace {
 
-Visualization* createClock(Display* display) {
-  return new Clock(display);
+Visualization* createClock(Display* display, void* storage) {
+  return new (storage) Clock(display);
 }
 
-Visualization* createColumns(Display* display) {
-  return new Columns(display, 50, true);
+Visualization* createColumns(Display* display, void* storage) {
+  return new (storage) Columns(display, 50, true);
 }
 
-Visualization* createText(Display* display) {
-  return new Text("HELLO", display);
+Visualization* createText(Display* display, void* storage) {
+  return new (storage) Text("HELLO", display);
 }
 
-Visualization* createSnow(Display* display) {
-  return new Snow(display);
+Visualization* createMarquee(Display* display, void* storage) {
+  return new (storage) Marquee(display);
+}
+
+Visualization* createSnow(Display* display, void* storage) {
+  return new (storage) Snow(display);
+}
+
+template<typename T, typename V, V (T::*Get)() const>
+unsigned long getNumber(const Visualization* visualization) {
+  return (unsigned long)(static_cast<const T*>(visualization)->*Get)();
+}
+
+template<typename T, typename V, void (T::*Set)(V)>
+void setNumber(Visualization* visualization, unsigned long value) {
+  (static_cast<T*>(visualization)->*Set)((V)value);
+}
+
+template<typename T, const char* (T::*Get)() const>
+const char* getText(const Visualization* visualization) {
+  return (static_cast<const T*>(visualization)->*Get)();
+}
+
+template<typename T, void (T::*Set)(const char*)>
+void setText(Visualization* visualization, const char* value) {
+  (static_cast<T*>(visualization)->*Set)(value);
+}
+
+template<typename T, typename V, V (T::*Get)() const, void (T::*Set)(V)>
+constexpr VisualizationParameter number(const char* name, const char* label, const char* help,
+                                        unsigned long min, unsigned long max, unsigned long step) {
+  return {name, label, help, ParameterType::NUMBER, min, max, step,
+          getNumber<T, V, Get>, setNumber<T, V, Set>, nullptr, nullptr};
+}
+
+template<typename T, const char* (T::*Get)() const, void (T::*Set)(const char*)>
+constexpr VisualizationParameter text(const char* name, const char* label, const char* help, unsigned long maxLength) {
+  return {name, label, help, ParameterType::TEXT, 0, maxLength, 0,
+          nullptr, nullptr, getText<T, Get>, setText<T, Set>};
+}
+
+constexpr VisualizationParameter MARQUEE_PARAMETERS[] = {
+  text<Marquee, &Marquee::getText, &Marquee::setText>(
+    "text", "Text", "Scrolled from right to left. Up to 64 characters.", Marquee::MAX_TEXT_LENGTH),
+  number<Marquee, unsigned long, &Marquee::getSpeed, &Marquee::setSpeed>(
+    "speed", "Speed (ms)", "Time per one-column step. Set 0 to pause.", 0, 1000, 10),
+};
+
+constexpr VisualizationParameter SNOW_PARAMETERS[] = {
+  number<Snow, unsigned long, &Snow::getGravity, &Snow::setGravity>(
+    "gravity", "Gravity (ms)", "Time between downward steps. Set 0 to freeze snow in place.", 0, 2000, 10),
+  number<Snow, unsigned long, &Snow::getSnowRate, &Snow::setSnowRate>(
+    "snowRate", "Snow Rate (ms)", "Lower values create flakes more frequently. 0 disables new snow.", 0, 5000, 50),
+  number<Snow, unsigned long, &Snow::getMeltRate, &Snow::setMeltRate>(
+    "meltRate", "Melt Rate (ms)", "Lower values melt faster. 0 disables melting.", 0, 10000, 100),
+  number<Snow, uint8_t, &Snow::getWind, &Snow::setWind>(
+    "wind", "Wind (%)", "Chance that a falling flake drifts sideways.", 0, 100, 1),
+  number<Snow, uint32_t, &Snow::getSeed, &Snow::setSeed>(
+    "seed", "Seed", "Restarts the random sequence.", 0, 0xFFFFFFFFUL, 1),
+};
+
+template<typename T, size_t N>
+constexpr size_t countOf(const T (&)[N]) {
+  return N;
+}
+
+template<size_t N>
+constexpr size_t countText(const VisualizationParameter (&parameters)[N]) {
+  size_t count = 0;
+  for (size_t i = 0; i < N; i++) {
+    if (parameters[i].type == ParameterType::TEXT) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+static_assert(countOf(MARQUEE_PARAMETERS) <= MAX_VISUALIZATION_PARAMETERS &&
+              countText(MARQUEE_PARAMETERS) <= MAX_VISUALIZATION_TEXT_PARAMETERS,
+              "raise MAX_VISUALIZATION_PARAMETERS or MAX_VISUALIZATION_TEXT_PARAMETERS");
+static_assert(countOf(SNOW_PARAMETERS) <= MAX_VISUALIZATION_PARAMETERS &&
+              countText(SNOW_PARAMETERS) <= MAX_VISUALIZATION_TEXT_PARAMETERS,
+              "raise MAX_VISUALIZATION_PARAMETERS or MAX_VISUALIZATION_TEXT_PARAMETERS");
+
+static_assert(VISUALIZATION_CACHE_SLOTS >= 1, "at least one visualization must fit");
+
+struct Slot {
+  VisualizationStorage storage;
+  const VisualizationDefinition* definition;
+  Visualization* instance;
+  // Value of useCounter when the slot was last activated
+  uint32_t lastUsed;
+};
+
+Slot slots[VISUALIZATION_CACHE_SLOTS];
+Slot* active = nullptr;
+uint32_t useCounter = 0;
+
+// The slot already holding `definition`, else an empty slot, else the least
+// recently used one
+Slot* slotFor(const VisualizationDefinition* definition) {
+  Slot* candidate = nullptr;
+  for (Slot& slot : slots) {
+    if (slot.instance && slot.definition == definition) {
+      return &slot;
+    }
+    if (!candidate || (candidate->instance && (!slot.instance || slot.lastUsed < candidate->lastUsed))) {
+      candidate = &slot;
+    }
+  }
+  return candidate;
+}
+
+void evict(Slot* slot) {
+  if (slot->instance) {
+    slot->instance->~Visualization();
+    slot->instance = nullptr;
+    slot->definition = nullptr;
+  }
+  if (active == slot) {
+    active = nullptr;
+  }
 }
 
 constexpr VisualizationDefinition VISUALIZATION_DEFINITIONS[] = {
-  {"clock", "Clock", createClock},
-  {"columns", "Columns", createColumns},
-  {"snow", "Snow", createSnow},
-  {"text", "Text", createText},
+  {"clock", "Clock", createClock, nullptr, 0},
+  {"columns", "Columns", createColumns, nullptr, 0},
+  {"marquee", "Marquee", createMarquee, MARQUEE_PARAMETERS, countOf(MARQUEE_PARAMETERS)},
+  {"snow", "Snow", createSnow, SNOW_PARAMETERS, countOf(SNOW_PARAMETERS)},
+  {"text", "Text", createText, nullptr, 0},
 };
 
 constexpr size_t VISUALIZATION_COUNT = sizeof(VISUALIZATION_DEFINITIONS) / sizeof(VISUALIZATION_DEFINITIONS[0]);
@@ -63,17 +188,35 @@ const VisualizationDefinition* defaultVisualization() {
   return &VISUALIZATION_DEFINITIONS[0];
 }
 
-Visualization* createVisualization(const VisualizationDefinition* definition, Display* display) {
+Visualization* activateVisualization(const VisualizationDefinition* definition, Display* display) {
   if (!definition || !definition->create) {
     return nullptr;
   }
-  return definition->create(display);
+  if (active && active->definition == definition) {
+    return active->instance;
+  }
+  if (active) {
+    active->instance->suspend();
+  }
+  Slot* slot = slotFor(definition);
+  if (slot->instance && slot->definition == definition) {
+    slot->instance->resume();
+  } else {
+    evict(slot);
+    slot->instance = definition->create(display, slot->storage.bytes);
+    slot->definition = definition;
+  }
+  slot->lastUsed = ++useCounter;
+  active = slot;
+  return slot->instance;
 }
 
-Visualization* createVisualizationById(const char* id, Display* display) {
-  const VisualizationDefinition* definition = findVisualizationInternal(id);
-  if (!definition) {
-    return nullptr;
+Visualization* activateVisualizationById(const char* id, Display* display) {
+  return activateVisualization(findVisualizationInternal(id), display);
+}
+
+void destroyVisualizations() {
+  for (Slot& slot : slots) {
+    evict(&slot);
   }
-  return createVisualization(definition, display);
 }
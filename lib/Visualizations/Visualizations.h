@@ -1,18 +1,68 @@
 #pragma once
 
 #include <stddef.h>
+#include <stdint.h>
+
+#include "Display.h"
 
-class Display;
 class Visualization;
 
+enum class ParameterType : uint8_t {
+  NUMBER,
+  TEXT,
+};
+
+// A tunable setting of a visualization. The accessors are thunks bound at
+// compile time to the getter and setter of the one class the owning
+// definition constructs, so they may only be given that class's instances.
+struct VisualizationParameter {
+  const char* name;
+  const char* label;
+  const char* help;
+  ParameterType type;
+  // NUMBER: accepted range, values outside are clamped, and the UI step.
+  // TEXT: `max` is the longest accepted text.
+  unsigned long min;
+  unsigned long max;
+  unsigned long step;
+  unsigned long (*getNumber)(const Visualization* visualization);
+  void (*setNumber)(Visualization* visualization, unsigned long value);
+  const char* (*getText)(const Visualization* visualization);
+  void (*setText)(Visualization* visualization, const char* value);
+};
+
 struct VisualizationDefinition {
   const char* id;
   const char* label;
-  Visualization* (*create)(Display* display);
+  // Construct the visualization into `storage`, a VisualizationStorage
+  // (see VisualizationStorage.h)
+  Visualization* (*create)(Display* display, void* storage);
+  const VisualizationParameter* parameters;
+  size_t parameterCount;
 };
 
+// Most parameters a definition declares, and most of those of type TEXT.
+// The web server keeps a copy of the current values that has room for this
+// many.
+constexpr size_t MAX_VISUALIZATION_PARAMETERS = 5;
+constexpr size_t MAX_VISUALIZATION_TEXT_PARAMETERS = 1;
+
+// Number of visualizations kept resident at once. Each slot is one
+// statically allocated VisualizationStorage, sized for the largest
+// visualization.
+#ifndef VISUALIZATION_CACHE_SLOTS
+#define VISUALIZATION_CACHE_SLOTS 3
+#endif
+
 const VisualizationDefinition* availableVisualizations(size_t* count);
 const VisualizationDefinition* findVisualization(const char* id);
 const VisualizationDefinition* defaultVisualization();
-Visualization* createVisualization(const VisualizationDefinition* definition, Display* display);
-Visualization* createVisualizationById(const char* id, Display* display);
+// Make `definition` the active visualization and suspend the previous one.
+// A resident instance is resumed with its state intact; otherwise a new one
+// is constructed, evicting (destroying) the least recently used instance
+// when every slot is taken. Returns nullptr and changes nothing for an
+// unknown definition.
+Visualization* activateVisualization(const VisualizationDefinition* definition, Display* display);
+Visualization* activateVisualizationById(const char* id, Display* display);
+// Destroy every resident visualization
+void destroyVisualizations();
@@ -2,23 +2,314 @@
 #include "hardware.h"
 #include "LedMatrix.h"
 #include "Visualization.h"
-#include "Snow.h"
+#include "Playlist.h"
+#include "Compositor.h"
+#include "Bits.h"
+#include "JsonWriter.h"
 
 #include <ESPAsyncWebServer.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <strings.h>
 #if defined(ESP8266)
 #include <LittleFS.h>
 #elif defined(ESP32)
 #include <LittleFS.h>
 #endif
 
+namespace {
+
+// Size of a binary frame: one little-endian row word per row
+constexpr size_t FRAME_BYTES = Display::ROWS * sizeof(Display::Row);
+
+// Responses that fit are built on the stack and sent in one piece; longer
+// ones are streamed to the client through a buffer of this size
+constexpr size_t JSON_BUFFER_SIZE = 256;
+
+// Send a document built in a JsonWriter without a sink
+void sendJson(AsyncWebServerRequest* request, int code, const JsonWriter& json) {
+  if (json.overflowed()) {
+    request->send(500, "application/json", "{\"error\":\"response too large\"}");
+    return;
+  }
+  request->send(code, "application/json", json.c_str());
+}
+
+void sendError(AsyncWebServerRequest* request, int code, const char* message) {
+  char buffer[JSON_BUFFER_SIZE];
+  JsonWriter json(buffer, sizeof(buffer));
+  json.beginObject().field("error", message).endObject();
+  sendJson(request, code, json);
+}
+
+void sendBusy(AsyncWebServerRequest* request) {
+  sendError(request, 503, "too many pending changes, try again");
+}
+
+// Serialize a document whose size depends on the configuration with
+// `write`, straight into the response
+template<typename Write>
+void streamJson(AsyncWebServerRequest* request, int code, Write write) {
+  AsyncResponseStream* response = request->beginResponseStream("application/json");
+  response->setCode(code);
+  char buffer[JSON_BUFFER_SIZE];
+  JsonWriter json(buffer, sizeof(buffer), response);
+  write(json);
+  json.flush();
+  request->send(response);
+}
+
+// How many pixels `changes` write, whether they switch or not
+uint16_t countPixels(const PixelChange* changes, size_t count) {
+  uint16_t pixels = 0;
+  for (size_t i = 0; i < count; i++) {
+    pixels = (uint16_t)(pixels + Bits::popcount(changes[i].mask));
+  }
+  return pixels;
+}
+
+// Parse a pixel list of the form "x,y,on;x,y,on;..." with `on` 0 or 1 into
+// at most one change per row; a later entry for the same pixel wins.
+// Returns the number of changes, or -1 if any entry is malformed or off
+// the display.
+int parsePixelList(const char* spec, PixelChange* changes) {
+  Display::Row masks[Display::ROWS] = {};
+  Display::Row bits[Display::ROWS] = {};
+  const char* p = spec;
+  while (p && *p) {
+    char* end = nullptr;
+    const unsigned long x = strtoul(p, &end, 10);
+    if (end == p || *end != ',') {
+      return -1;
+    }
+    p = end + 1;
+    const unsigned long y = strtoul(p, &end, 10);
+    if (end == p || *end != ',') {
+      return -1;
+    }
+    p = end + 1;
+    if ((*p != '0' && *p != '1') || (p[1] != ';' && p[1] != '\0')) {
+      return -1;
+    }
+    if (x >= Display::COLUMNS || y >= Display::ROWS) {
+      return -1;
+    }
+    const Display::Row mask = Display::bit((uint8_t)x);
+    masks[y] |= mask;
+    if (*p == '1') {
+      bits[y] |= mask;
+    } else {
+      bits[y] &= (Display::Row)~mask;
+    }
+    p += p[1] == ';' ? 2 : 1;
+  }
+  int count = 0;
+  for (uint8_t y = 0; y < Display::ROWS; y++) {
+    if (masks[y]) {
+      changes[count++] = {y, masks[y], bits[y]};
+    }
+  }
+  return count;
+}
+
+// Decode standard or URL-safe base64, padding optional. Returns the
+// decoded length, or -1 for invalid input or more than `capacity` bytes.
+int decodeBase64(const char* in, uint8_t* out, size_t capacity) {
+  size_t length = 0;
+  uint32_t buffer = 0;
+  uint8_t bitCount = 0;
+  for (const char* p = in; p && *p && *p != '='; ++p) {
+    const char c = *p;
+    uint8_t value;
+    if (c >= 'A' && c <= 'Z') value = (uint8_t)(c - 'A');
+    else if (c >= 'a' && c <= 'z') value = (uint8_t)(c - 'a' + 26);
+    else if (c >= '0' && c <= '9') value = (uint8_t)(c - '0' + 52);
+    else if (c == '+' || c == '-') value = 62;
+    else if (c == '/' || c == '_') value = 63;
+    else return -1;
+    buffer = (buffer << 6) | value;
+    bitCount += 6;
+    if (bitCount >= 8) {
+      bitCount -= 8;
+      if (length >= capacity) {
+        return -1;
+      }
+      out[length++] = (uint8_t)(buffer >> bitCount);
+    }
+  }
+  return (int)length;
+}
+
+// Write a row mask as lowercase hex without leading zeros
+char* writeHex(char* out, Display::Row value) {
+  char digits[2 * sizeof(Display::Row)];
+  uint8_t count = 0;
+  do {
+    digits[count++] = "0123456789abcdef"[value & 0xF];
+    value >>= 4;
+  } while (value);
+  while (count) {
+    *out++ = digits[--count];
+  }
+  return out;
+}
+
+// Parameter metadata of a visualization as a JSON array
+void writeParameters(JsonWriter& json, const VisualizationDefinition& definition) {
+  json.beginArray();
+  for (size_t i = 0; i < definition.parameterCount; i++) {
+    const VisualizationParameter& parameter = definition.parameters[i];
+    json.beginObject()
+        .field("name", parameter.name)
+        .field("label", parameter.label)
+        .field("help", parameter.help);
+    if (parameter.type == ParameterType::TEXT) {
+      json.field("type", "text").field("maxLength", parameter.max);
+    } else {
+      json.field("type", "number")
+          .field("min", parameter.min)
+          .field("max", parameter.max)
+          .field("step", parameter.step);
+    }
+    json.endObject();
+  }
+  json.endArray();
+}
+
+// Parameter values of a definition as published: numbers by parameter
+// index, texts in the order of the TEXT parameters
+template<size_t TextSize>
+void writeConfig(JsonWriter& json, const VisualizationDefinition* definition, const unsigned long* numbers,
+                 const char (*texts)[TextSize]) {
+  json.beginObject();
+  size_t text = 0;
+  for (size_t i = 0; i < definition->parameterCount; i++) {
+    const VisualizationParameter& parameter = definition->parameters[i];
+    json.key(parameter.name);
+    if (parameter.type == ParameterType::TEXT) {
+      json.value(texts[text++]);
+    } else {
+      json.value(numbers[i]);
+    }
+  }
+  json.endObject();
+}
+
+// "1", "true" or "on" in any case
+bool parseOn(const char* value) {
+  return strcmp(value, "1") == 0 || strcasecmp(value, "true") == 0 || strcasecmp(value, "on") == 0;
+}
+
+// `text` as a number parameter takes it
+unsigned long clampNumber(const VisualizationParameter& parameter, const char* text) {
+  const unsigned long number = strtoul(text, nullptr, 10);
+  if (number < parameter.min) {
+    return parameter.min;
+  }
+  return number > parameter.max ? parameter.max : number;
+}
+
+void sendInactive(AsyncWebServerRequest* request, const VisualizationDefinition* definition) {
+  char message[64];
+  snprintf(message, sizeof(message), "%s visualization inactive", definition->id);
+  sendError(request, 409, message);
+}
+
+void sendTransform(AsyncWebServerRequest* request, const Transform& transform) {
+  char buffer[JSON_BUFFER_SIZE];
+  JsonWriter json(buffer, sizeof(buffer));
+  json.beginObject()
+      .field("rotation", Transform::degrees(transform.getRotation()))
+      .field("mirror", transform.getMirror())
+      .field("flip", transform.getFlip())
+      .field("invert", transform.getInvert())
+      .field("dx", transform.getOffsetX())
+      .field("dy", transform.getOffsetY())
+      .field("quarterTurns", Transform::QUARTER_TURNS)
+      .endObject();
+  sendJson(request, 200, json);
+}
+
+void sendPlaylist(AsyncWebServerRequest* request, const Playlist::Entry* entries, uint8_t count, bool running,
+                  uint8_t index, Playlist::Transition transition, unsigned long transitionMs) {
+  streamJson(request, 200, [=](JsonWriter& json) {
+    json.beginObject()
+        .field("running", running)
+        .field("index", index)
+        .field("transition", Playlist::transitionName(transition))
+        .field("transitionMs", transitionMs)
+        .key("entries").beginArray();
+    for (uint8_t i = 0; i < count; ++i) {
+      json.beginObject().field("id", entries[i].definition->id).field("duration", entries[i].durationMs).endObject();
+    }
+    json.endArray().endObject();
+  });
+}
+
+void sendLayers(AsyncWebServerRequest* request, const VisualizationDefinition* const* definitions, const RasterOp* ops) {
+  streamJson(request, 200, [=](JsonWriter& json) {
+    json.beginObject().key("layers").beginArray();
+    for (uint8_t i = 0; i < Compositor::MAX_LAYERS; ++i) {
+      json.beginObject()
+          .field("index", i)
+          .field("id", definitions[i] ? definitions[i]->id : nullptr)
+          .field("op", Compositor::opName(ops[i]))
+          .endObject();
+    }
+    json.endArray().endObject();
+  });
+}
+
+// Parse a playlist spec of the form "id:ms,id:ms,...". Returns the number
+// of entries, or -1 if any entry is malformed, names an unknown
+// visualization, has a zero duration or there are too many.
+int parsePlaylistEntries(const char* spec, Playlist::Entry* entries) {
+  int count = 0;
+  const char* p = spec;
+  while (p && *p) {
+    if (count >= Playlist::MAX_ENTRIES) {
+      return -1;
+    }
+    const char* colon = strchr(p, ':');
+    if (!colon) {
+      return -1;
+    }
+    char id[32];
+    const size_t idLength = (size_t)(colon - p);
+    if (idLength == 0 || idLength >= sizeof(id)) {
+      return -1;
+    }
+    memcpy(id, p, idLength);
+    id[idLength] = '\0';
+    char* end = nullptr;
+    const unsigned long duration = strtoul(colon + 1, &end, 10);
+    if (end == colon + 1 || duration == 0 || (*end != ',' && *end != '\0')) {
+      return -1;
+    }
+    entries[count].definition = findVisualization(id);
+    entries[count].durationMs = duration;
+    if (!entries[count].definition) {
+      return -1;
+    }
+    ++count;
+    p = *end == ',' ? end + 1 : end;
+  }
+  return count;
+}
+
+}  // namespace
+
 WebServer::WebServer(Display* display,
                      LedMatrix* ledMatrix,
                      const VisualizationDefinition* visualizationDefinitions,
                      size_t visualizationDefinitionCount,
                      VisualizationSetter setVisualizationCallback,
                      VisualizationGetter getCurrentVisualizationIdCallback,
-                     VisualizationAccessor getCurrentVisualizationCallback)
+                     VisualizationAccessor getCurrentVisualizationCallback,
+                     Playlist* playlist,
+                     Compositor* compositor,
+                     RequestObserver requestCallback)
   : display(display),
     ledMatrix(ledMatrix),
     asyncWebServer(nullptr),
@@ -26,9 +317,35 @@ WebServer::WebServer(Display* display,
     visualizationDefinitionCount(visualizationDefinitionCount),
     setVisualizationCallback(setVisualizationCallback),
     getCurrentVisualizationIdCallback(getCurrentVisualizationIdCallback),
-    getCurrentVisualizationCallback(getCurrentVisualizationCallback)
+    getCurrentVisualizationCallback(getCurrentVisualizationCallback),
+    playlist(playlist),
+    compositor(compositor),
+    requestCallback(requestCallback),
+    events(nullptr),
+    pushedRows{},
+    pushedSequence(0),
+    lastPush(0),
+    framePending(false),
+    eventPayload{},
+    frameBody{},
+    frameBodyOwner(nullptr),
+#if defined(ESP8266)
+    bootId(ESP.random())
+#elif defined(ESP32)
+    bootId(esp_random())
+#else
+    bootId(micros())
+#endif
 {
   asyncWebServer = new AsyncWebServer(80);
+  // Requests are handled from the network stack, outside loop(); tell the
+  // owner once one has run so it can pick up the changes without polling.
+  if (this->requestCallback) {
+    asyncWebServer->addMiddleware([this](AsyncWebServerRequest *request, ArMiddlewareNext next) {
+      next();
+      this->requestCallback();
+    });
+  }
   // Mount LittleFS and serve static files from it (default to index.html)
 #if defined(ESP8266)
   if (!LittleFS.begin()) {
@@ -47,60 +364,191 @@ WebServer::WebServer(Display* display,
   asyncWebServer->serveStatic("/", LittleFS, "/").setDefaultFile("index.html");
 
   asyncWebServer->on("/hardware.json", HTTP_GET, [](AsyncWebServerRequest *request) {
-    String response = "{";
-    response += "\"columns\":";
-    response += LED_MATRIX_COLS;
-    response += ",\"rows\":";
-    response += LED_MATRIX_ROWS;
-    response += "}";
-    request->send(200, "application/json", response);
+    char buffer[JSON_BUFFER_SIZE];
+    JsonWriter json(buffer, sizeof(buffer));
+    json.beginObject().field("columns", LED_MATRIX_COLS).field("rows", LED_MATRIX_ROWS).endObject();
+    sendJson(request, 200, json);
   });
 
   // Return framebuffer as an array of row bitmasks
   asyncWebServer->on("/display", HTTP_GET, [this](AsyncWebServerRequest *request) {
-    String response = "{";
-    response += "\"columns\":";
-    response += this->display->width();
-    response += ",\"rows\":";
-    response += this->display->height();
-    response += ",\"framebuffer\":[";
-    for (uint8_t y = 0; y < this->display->height(); y++) {
-      if (y > 0) response += ",";
-      response += (unsigned long)this->display->rowBits(y);
-    }
-    response += "]}";
-    request->send(200, "application/json", response);
+    const State& state = this->published.read();
+    streamJson(request, 200, [&state](JsonWriter& json) {
+      json.beginObject()
+          .field("columns", Display::COLUMNS)
+          .field("rows", Display::ROWS)
+          .key("framebuffer").beginArray();
+      for (uint8_t y = 0; y < Display::ROWS; y++) {
+        json.value(state.rows[y]);
+      }
+      json.endArray().endObject();
+    });
   });
 
-  // Set a pixel: PUT /display?x=..&y=..&on=0|1 (also accepts body params)
-  auto currentSnow = [this]() -> Snow* {
-    if (!this->getCurrentVisualizationIdCallback || !this->getCurrentVisualizationCallback) {
-      return nullptr;
+  // Raw front buffer: one little-endian word of sizeof(Display::Row) bytes
+  // per row, top row first. The ETag is the boot id and the frame sequence
+  // number, so a poll that already has the current frame gets a bodyless
+  // 304 and one from before a reboot never does.
+  asyncWebServer->on("/display.bin", HTTP_GET, [this](AsyncWebServerRequest *request) {
+    const State& state = this->published.read();
+    char etag[24];
+    snprintf(etag, sizeof(etag), "\"%lx-%lu\"", (unsigned long)this->bootId, (unsigned long)state.sequence);
+
+    const AsyncWebHeader* ifNoneMatch = request->getHeader("If-None-Match");
+    if (ifNoneMatch && ifNoneMatch->value() == etag) {
+      AsyncWebServerResponse* response = request->beginResponse(304);
+      response->addHeader("ETag", etag);
+      request->send(response);
+      return;
     }
-    const char* id = this->getCurrentVisualizationIdCallback();
-    if (!id) {
-      return nullptr;
+
+    uint8_t frame[FRAME_BYTES];
+    uint8_t* out = frame;
+    for (uint8_t y = 0; y < Display::ROWS; y++) {
+      const Display::Row bits = state.rows[y];
+      for (uint8_t i = 0; i < sizeof(Display::Row); i++) {
+        *out++ = (uint8_t)(bits >> (8 * i));
+      }
     }
-    if (String(id) != "snow") {
-      return nullptr;
+
+    AsyncResponseStream* response = request->beginResponseStream("application/octet-stream", sizeof(frame));
+    response->addHeader("ETag", etag);
+    response->addHeader("Cache-Control", "no-cache");
+    char columns[4];
+    char rows[4];
+    snprintf(columns, sizeof(columns), "%u", (unsigned)Display::COLUMNS);
+    snprintf(rows, sizeof(rows), "%u", (unsigned)Display::ROWS);
+    response->addHeader("X-Columns", columns);
+    response->addHeader("X-Rows", rows);
+    response->write(frame, sizeof(frame));
+    request->send(response);
+  });
+
+  // Push channel: GET /events is an EventSource stream. A new client gets a
+  // "frame" event with every row ("<seq> <columns> <rows> <hex>..."), then
+  // "delta" events with just the rows that changed ("<seq> <y>:<hex>...").
+  // Rows are hex masks, column 0 in bit 0.
+  // The frame is sent from loop(), which owns pushedRows and eventPayload;
+  // if it cannot be queued the client is dropped and the browser retries.
+  events = new AsyncEventSource("/events");
+  events->onConnect([this](AsyncEventSourceClient *client) {
+    Command command;
+    command.type = Command::Type::SEND_FRAME;
+    if (!this->commands.push(command)) {
+      client->close();
+      return;
     }
-    Visualization* viz = this->getCurrentVisualizationCallback();
-    if (!viz) {
-      return nullptr;
+    if (this->requestCallback) {
+      this->requestCallback();
     }
-    return static_cast<Snow*>(viz);
-  };
+  });
+  asyncWebServer->addHandler(events);
 
-  auto snowConfigJson = [](Snow* snow) -> String {
-    String json = "{";
-    json += "\"gravity\":"; json += snow->getGravity(); json += ",";
-    json += "\"snowRate\":"; json += snow->getSnowRate(); json += ",";
-    json += "\"meltRate\":"; json += snow->getMeltRate(); json += ",";
-    json += "\"wind\":"; json += (int)snow->getWind();
-    json += "}";
-    return json;
-  };
+  // AsyncWebServer also hands "<uri>/..." to a handler for <uri> and the
+  // first match wins, so the /display/... PUT routes have to be registered
+  // before PUT /display.
+
+  // Set many pixels at once: PUT /display/pixels?pixels=x,y,on;x,y,on;...
+  // (also accepts a body param). The list is applied as a whole or, if any
+  // entry is invalid, not at all.
+  asyncWebServer->on("/display/pixels", HTTP_PUT, [this](AsyncWebServerRequest *request) {
+    const AsyncWebParameter* pixels = nullptr;
+    if (request->hasParam("pixels")) {
+      pixels = request->getParam("pixels");
+    } else if (request->hasParam("pixels", true)) {
+      pixels = request->getParam("pixels", true);
+    }
+    if (!pixels) {
+      sendError(request, 400, "pixels is required");
+      return;
+    }
+    PixelChange changes[Display::ROWS];
+    const int count = parsePixelList(pixels->value().c_str(), changes);
+    if (count < 0) {
+      sendError(request, 400, "pixels must be x,y,0|1 entries separated by ; and on the display");
+      return;
+    }
+    if (!this->queuePixelChanges(changes, (size_t)count)) {
+      sendBusy(request);
+      return;
+    }
+    char buffer[JSON_BUFFER_SIZE];
+    JsonWriter json(buffer, sizeof(buffer));
+    json.beginObject().field("pixels", countPixels(changes, (size_t)count)).endObject();
+    sendJson(request, 200, json);
+  });
+
+  // Replace the whole frame: PUT /display/frame with an octet-stream body
+  // in the /display.bin layout, or with that frame base64 encoded in a
+  // `frame` param
+  asyncWebServer->on("/display/frame", HTTP_PUT, [this](AsyncWebServerRequest *request) {
+    uint8_t decoded[FRAME_BYTES];
+    const uint8_t* frame = nullptr;
+    if (this->frameBodyOwner == request) {
+      frame = this->frameBody;
+    } else {
+      const AsyncWebParameter* encoded = nullptr;
+      if (request->hasParam("frame")) {
+        encoded = request->getParam("frame");
+      } else if (request->hasParam("frame", true)) {
+        encoded = request->getParam("frame", true);
+      }
+      if (encoded && decodeBase64(encoded->value().c_str(), decoded, sizeof(decoded)) == (int)sizeof(decoded)) {
+        frame = decoded;
+      }
+    }
+    if (!frame && this->frameBodyOwner && request->contentLength() == FRAME_BYTES) {
+      // Another upload holds frameBody
+      sendBusy(request);
+      return;
+    }
+    if (!frame) {
+      char message[80];
+      snprintf(message, sizeof(message), "frame must be %u bytes of little-endian row masks, raw or base64", (unsigned)FRAME_BYTES);
+      sendError(request, 400, message);
+      return;
+    }
+
+    PixelChange changes[Display::ROWS];
+    for (uint8_t y = 0; y < Display::ROWS; y++) {
+      Display::Row bits = 0;
+      for (uint8_t i = 0; i < sizeof(Display::Row); i++) {
+        bits |= (Display::Row)frame[y * sizeof(Display::Row) + i] << (8 * i);
+      }
+      changes[y] = {y, Display::FULL_ROW, bits};
+    }
+    if (this->frameBodyOwner == request) {
+      this->frameBodyOwner = nullptr;
+    }
+    if (!this->queuePixelChanges(changes, Display::ROWS)) {
+      sendBusy(request);
+      return;
+    }
+    char buffer[JSON_BUFFER_SIZE];
+    JsonWriter json(buffer, sizeof(buffer));
+    json.beginObject().field("pixels", countPixels(changes, Display::ROWS)).endObject();
+    sendJson(request, 200, json);
+  }, nullptr, [this](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+    // Collect a raw body into frameBody; anything but exactly one frame is
+    // left out and rejected by the handler above. One upload at a time owns
+    // the buffer, until its handler ran or the client went away.
+    if (total != FRAME_BYTES) {
+      return;
+    }
+    if (index == 0 && !this->frameBodyOwner) {
+      this->frameBodyOwner = request;
+      request->onDisconnect([this, request]() {
+        if (this->frameBodyOwner == request) {
+          this->frameBodyOwner = nullptr;
+        }
+      });
+    }
+    if (this->frameBodyOwner == request && index + len <= total) {
+      memcpy(this->frameBody + index, data, len);
+    }
+  });
 
+  // Set a pixel: PUT /display?x=..&y=..&on=0|1 (also accepts body params)
   asyncWebServer->on("/display", HTTP_PUT, [this](AsyncWebServerRequest *request) {
     auto getParam = [&](const char* name) -> const AsyncWebParameter* {
       if (request->hasParam(name)) {
@@ -116,91 +564,181 @@ WebServer::WebServer(Display* display,
     const AsyncWebParameter* py = getParam("y");
     const AsyncWebParameter* pon = getParam("on");
     if (!px || !py || !pon) {
-      request->send(400, "application/json", "{\"error\":\"x, y, and on are required\"}");
+      sendError(request, 400, "x, y, and on are required");
       return;
     }
 
     int x = px->value().toInt();
     int y = py->value().toInt();
-    String onStr = pon->value();
-    onStr.toLowerCase();
-    bool on = (onStr == "1" || onStr == "true" || onStr == "on");
+    bool on = parseOn(pon->value().c_str());
 
-    if (x < 0 || y < 0 || x >= this->display->width() || y >= this->display->height()) {
-      request->send(400, "application/json", "{\"error\":\"x or y out of range\"}");
+    if (x < 0 || y < 0 || x >= Display::COLUMNS || y >= Display::ROWS) {
+      sendError(request, 400, "x or y out of range");
       return;
     }
 
-    bool vizHandled = false;
-    bool changed = false;
-    if (this->getCurrentVisualizationCallback) {
-      Visualization* viz = this->getCurrentVisualizationCallback();
-      if (viz) {
-        bool before = this->display->getPixel((uint8_t)x, (uint8_t)y);
-        if (viz->handlePixelChange((uint8_t)x, (uint8_t)y, on)) {
-          vizHandled = true;
-          bool after = this->display->getPixel((uint8_t)x, (uint8_t)y);
-          changed = (before != after);
-        }
-      }
+    const Display::Row mask = Display::bit((uint8_t)x);
+    const PixelChange change = {(uint8_t)y, mask, on ? mask : (Display::Row)0};
+    if (!this->queuePixelChanges(&change, 1)) {
+      sendBusy(request);
+      return;
     }
 
-    if (!vizHandled) {
-      changed = this->display->setPixel((uint8_t)x, (uint8_t)y, on);
-    }
-    String json = "{";
-    json += "\"x\":"; json += x; json += ",";
-    json += "\"y\":"; json += y; json += ",";
-    json += "\"on\":"; json += (on ? "true" : "false"); json += ",";
-    json += "\"changed\":"; json += (changed ? "true" : "false");
-    json += "}";
-    request->send(200, "application/json", json);
+    char buffer[JSON_BUFFER_SIZE];
+    JsonWriter json(buffer, sizeof(buffer));
+    json.beginObject().field("x", x).field("y", y).field("on", on).endObject();
+    sendJson(request, 200, json);
   });
 
   // Fill all pixels on/off: POST /display/fill?on=0|1 (default 1)
   asyncWebServer->on("/display/fill", HTTP_POST, [this](AsyncWebServerRequest *request) {
     bool on = true;
     if (request->hasParam("on")) {
-      String v = request->getParam("on")->value();
-      v.toLowerCase();
-      on = (v == "1" || v == "true" || v == "on");
+      on = parseOn(request->getParam("on")->value().c_str());
     } else if (request->hasParam("on", true)) {
-      String v = request->getParam("on", true)->value();
-      v.toLowerCase();
-      on = (v == "1" || v == "true" || v == "on");
+      on = parseOn(request->getParam("on", true)->value().c_str());
     }
-    this->display->fill(on);
-    request->send(200, "application/json", String("{\"filled\":" ) + (on ? "true" : "false") + "}");
+    Command command;
+    command.type = Command::Type::FILL;
+    command.payload.on = on;
+    if (!this->commands.push(command)) {
+      sendBusy(request);
+      return;
+    }
+    char buffer[JSON_BUFFER_SIZE];
+    JsonWriter json(buffer, sizeof(buffer));
+    json.beginObject().field("filled", on).endObject();
+    sendJson(request, 200, json);
   });
 
   // Clear all pixels: DELETE /display
   asyncWebServer->on("/display", HTTP_DELETE, [this](AsyncWebServerRequest *request) {
-    this->display->clear();
-    request->send(200, "application/json", "{\"cleared\":true}");
+    Command command;
+    command.type = Command::Type::FILL;
+    command.payload.on = false;
+    if (!this->commands.push(command)) {
+      sendBusy(request);
+      return;
+    }
+    char buffer[JSON_BUFFER_SIZE];
+    JsonWriter json(buffer, sizeof(buffer));
+    json.beginObject().field("cleared", true).endObject();
+    sendJson(request, 200, json);
   });
 
+  // GET/PUT /visualizations/{id}/config for every visualization that
+  // declares parameters. Each handler is bound to its definition, and the
+  // parameter table's accessors to the class that definition constructs.
+  // AsyncWebServer also hands "<uri>/..." to a handler for <uri> and the
+  // first match wins, so these have to be registered before the
+  // /visualizations collection routes.
+  for (size_t i = 0; i < this->visualizationDefinitionCount; i++) {
+    const VisualizationDefinition* definition = &this->visualizationDefinitions[i];
+    if (definition->parameterCount == 0) {
+      continue;
+    }
+    String path = "/visualizations/";
+    path += definition->id;
+    path += "/config";
+
+    asyncWebServer->on(path.c_str(), HTTP_GET, [this, definition](AsyncWebServerRequest *request) {
+      const State& state = this->published.read();
+      if (state.configured != definition) {
+        sendInactive(request, definition);
+        return;
+      }
+      streamJson(request, 200, [definition, &state](JsonWriter& json) {
+        writeConfig(json, definition, state.numbers, state.texts);
+      });
+    });
+
+    asyncWebServer->on(path.c_str(), HTTP_PUT, [this, definition](AsyncWebServerRequest *request) {
+      const State& state = this->published.read();
+      if (state.configured != definition) {
+        sendInactive(request, definition);
+        return;
+      }
+
+      auto getParam = [&](const char* name) -> const AsyncWebParameter* {
+        if (request->hasParam(name)) {
+          return request->getParam(name);
+        }
+        if (request->hasParam(name, true)) {
+          return request->getParam(name, true);
+        }
+        return nullptr;
+      };
+
+      size_t provided = 0;
+      for (size_t p = 0; p < definition->parameterCount; p++) {
+        if (getParam(definition->parameters[p].name)) {
+          ++provided;
+        }
+      }
+      if (provided == 0) {
+        sendError(request, 400, "no parameters provided");
+        return;
+      }
+      // One command per parameter; queue all of them or none
+      if (this->commands.available() < provided) {
+        sendBusy(request);
+        return;
+      }
+
+      // The published values with this request's changes on top, to
+      // answer with the configuration this request leaves behind
+      unsigned long numbers[MAX_VISUALIZATION_PARAMETERS];
+      char texts[MAX_VISUALIZATION_TEXT_PARAMETERS][Command::MAX_TEXT_LENGTH + 1];
+      memcpy(numbers, state.numbers, sizeof(numbers));
+      memcpy(texts, state.texts, sizeof(texts));
+
+      Command command;
+      size_t text = 0;
+      for (size_t p = 0; p < definition->parameterCount; p++) {
+        const VisualizationParameter& parameter = definition->parameters[p];
+        const AsyncWebParameter* value = getParam(parameter.name);
+        if (parameter.type == ParameterType::TEXT) {
+          if (value) {
+            command.type = Command::Type::SET_TEXT;
+            command.payload.text.definition = definition;
+            command.payload.text.index = (uint8_t)p;
+            const size_t length = parameter.max < Command::MAX_TEXT_LENGTH ? parameter.max : Command::MAX_TEXT_LENGTH;
+            strncpy(command.payload.text.value, value->value().c_str(), length);
+            command.payload.text.value[length] = '\0';
+            this->commands.push(command);
+            strcpy(texts[text], command.payload.text.value);
+          }
+          ++text;
+        } else if (value) {
+          command.type = Command::Type::SET_NUMBER;
+          command.payload.number.definition = definition;
+          command.payload.number.index = (uint8_t)p;
+          command.payload.number.value = clampNumber(parameter, value->value().c_str());
+          this->commands.push(command);
+          numbers[p] = command.payload.number.value;
+        }
+      }
+
+      streamJson(request, 200, [definition, &numbers, &texts](JsonWriter& json) {
+        writeConfig(json, definition, numbers, texts);
+      });
+    });
+  }
+
   asyncWebServer->on("/visualizations", HTTP_GET, [this](AsyncWebServerRequest *request) {
-    String json = "{";
-    json += "\"current\":";
-    json += "\"";
-    if (this->getCurrentVisualizationIdCallback) {
-      json += this->getCurrentVisualizationIdCallback();
-    }
-    json += "\",";
-    json += "\"visualizations\":[";
-    for (size_t i = 0; i < this->visualizationDefinitionCount; i++) {
-      if (i > 0) {
-        json += ",";
-      }
-      json += "{";
-      json += "\"id\":\"";
-      json += this->visualizationDefinitions[i].id;
-      json += "\",\"label\":\"";
-      json += this->visualizationDefinitions[i].label;
-      json += "\"}";
-    }
-    json += "]}";
-    request->send(200, "application/json", json);
+    const State& state = this->published.read();
+    streamJson(request, 200, [this, &state](JsonWriter& json) {
+      json.beginObject()
+          .field("current", state.current ? state.current->id : "")
+          .key("visualizations").beginArray();
+      for (size_t i = 0; i < this->visualizationDefinitionCount; i++) {
+        const VisualizationDefinition& definition = this->visualizationDefinitions[i];
+        json.beginObject().field("id", definition.id).field("label", definition.label).key("parameters");
+        writeParameters(json, definition);
+        json.endObject();
+      }
+      json.endArray().endObject();
+    });
   });
 
   asyncWebServer->on("/visualizations", HTTP_POST, [this](AsyncWebServerRequest *request) {
@@ -212,94 +750,36 @@ WebServer::WebServer(Display* display,
     }
 
     if (!pid) {
-      request->send(400, "application/json", "{\"error\":\"id is required\"}");
-      return;
-    }
-
-    String id = pid->value();
-    bool success = false;
-    if (this->setVisualizationCallback) {
-      success = this->setVisualizationCallback(id.c_str());
-    }
-
-    if (!success) {
-      request->send(404, "application/json", "{\"error\":\"visualization not found\"}");
-      return;
-    }
-
-    String json = "{";
-    json += "\"current\":\"";
-    if (this->getCurrentVisualizationIdCallback) {
-      json += this->getCurrentVisualizationIdCallback();
-    }
-    json += "\"}";
-    request->send(200, "application/json", json);
-  });
-
-  asyncWebServer->on("/visualizations/snow/config", HTTP_GET, [this, currentSnow, snowConfigJson](AsyncWebServerRequest *request) {
-    Snow* snow = currentSnow();
-    if (!snow) {
-      request->send(409, "application/json", "{\"error\":\"snow visualization inactive\"}");
+      sendError(request, 400, "id is required");
       return;
     }
-    request->send(200, "application/json", snowConfigJson(snow));
-  });
 
-  asyncWebServer->on("/visualizations/snow/config", HTTP_PUT, [this, currentSnow, snowConfigJson](AsyncWebServerRequest *request) {
-    Snow* snow = currentSnow();
-    if (!snow) {
-      request->send(409, "application/json", "{\"error\":\"snow visualization inactive\"}");
+    const VisualizationDefinition* definition = findVisualization(pid->value().c_str());
+    if (!definition || !this->setVisualizationCallback) {
+      sendError(request, 404, "visualization not found");
       return;
     }
-
-    auto getParam = [&](const char* name) -> const AsyncWebParameter* {
-      if (request->hasParam(name)) {
-        return request->getParam(name);
-      }
-      if (request->hasParam(name, true)) {
-        return request->getParam(name, true);
-      }
-      return nullptr;
-    };
-
-    bool updated = false;
-
-    if (const AsyncWebParameter* p = getParam("gravity")) {
-      unsigned long value = strtoul(p->value().c_str(), nullptr, 10);
-      snow->setGravity(value);
-      updated = true;
-    }
-    if (const AsyncWebParameter* p = getParam("snowRate")) {
-      unsigned long value = strtoul(p->value().c_str(), nullptr, 10);
-      snow->setSnowRate(value);
-      updated = true;
-    }
-    if (const AsyncWebParameter* p = getParam("meltRate")) {
-      unsigned long value = strtoul(p->value().c_str(), nullptr, 10);
-      snow->setMeltRate(value);
-      updated = true;
-    }
-    if (const AsyncWebParameter* p = getParam("wind")) {
-      unsigned long value = strtoul(p->value().c_str(), nullptr, 10);
-      snow->setWind((uint8_t)value);
-      updated = true;
-    }
-
-    if (!updated) {
-      request->send(400, "application/json", "{\"error\":\"no parameters provided\"}");
+    Command command;
+    command.type = Command::Type::ACTIVATE;
+    command.payload.definition = definition;
+    if (!this->commands.push(command)) {
+      sendBusy(request);
       return;
     }
 
-    request->send(200, "application/json", snowConfigJson(snow));
+    char buffer[JSON_BUFFER_SIZE];
+    JsonWriter json(buffer, sizeof(buffer));
+    json.beginObject().field("current", definition->id).endObject();
+    sendJson(request, 200, json);
   });
 
   // Brightness endpoints
   // GET /brightness -> {"brightness":0..15}
   asyncWebServer->on("/brightness", HTTP_GET, [this](AsyncWebServerRequest *request) {
-    String json = "{";
-    json += "\"brightness\":"; json += (int)this->ledMatrix->intensity();
-    json += "}";
-    request->send(200, "application/json", json);
+    char buffer[JSON_BUFFER_SIZE];
+    JsonWriter json(buffer, sizeof(buffer));
+    json.beginObject().field("brightness", this->published.read().brightness).endObject();
+    sendJson(request, 200, json);
   });
   // PUT /brightness?value=0..15 (also accepts body param)
   asyncWebServer->on("/brightness", HTTP_PUT, [this](AsyncWebServerRequest *request) {
@@ -310,7 +790,7 @@ WebServer::WebServer(Display* display,
     };
     const AsyncWebParameter* pv = getParam("value");
     if (!pv) {
-      request->send(400, "application/json", "{\"error\":\"value is required\"}");
+      sendError(request, 400, "value is required");
       return;
     }
     int v = pv->value().toInt();
@@ -319,12 +799,547 @@ WebServer::WebServer(Display* display,
     } else if (v > LED_MATRIX_BRIGHTNESS_MAX) {
       v = LED_MATRIX_BRIGHTNESS_MAX;
     }
-    this->ledMatrix->setIntensity((uint8_t)v);
-    String json = "{";
-    json += "\"brightness\":"; json += v; json += "}";
-    request->send(200, "application/json", json);
+    Command command;
+    command.type = Command::Type::BRIGHTNESS;
+    command.payload.brightness = (uint8_t)v;
+    if (!this->commands.push(command)) {
+      sendBusy(request);
+      return;
+    }
+    char buffer[JSON_BUFFER_SIZE];
+    JsonWriter json(buffer, sizeof(buffer));
+    json.beginObject().field("brightness", v).endObject();
+    sendJson(request, 200, json);
+  });
+
+  // GET /transform -> {"rotation":0|90|180|270,"mirror":bool,"flip":bool,"invert":bool,"dx":..,"dy":..,"quarterTurns":bool}
+  asyncWebServer->on("/transform", HTTP_GET, [this](AsyncWebServerRequest *request) {
+    sendTransform(request, this->published.read().transform);
+  });
+
+  // PUT /transform?rotation=0|90|180|270&mirror=0|1&flip=0|1&invert=0|1&dx=..&dy=..
+  // (also accepts body params). Parameters left out keep their value.
+  asyncWebServer->on("/transform", HTTP_PUT, [this](AsyncWebServerRequest *request) {
+    auto getParam = [&](const char* name) -> const AsyncWebParameter* {
+      if (request->hasParam(name)) {return request->getParam(name);}
+      if (request->hasParam(name, true)) {return request->getParam(name, true);}
+      return nullptr;
+    };
+    Transform transform = this->published.read().transform;
+    bool updated = false;
+    if (const AsyncWebParameter* p = getParam("rotation")) {
+      Transform::Rotation rotation;
+      if (!Transform::fromDegrees(p->value().toInt(), &rotation)) {
+        sendError(request, 400, "rotation must be 0, 90, 180 or 270");
+        return;
+      }
+      if (!transform.setRotation(rotation)) {
+        sendError(request, 400, "quarter turns need a square panel");
+        return;
+      }
+      updated = true;
+    }
+    if (const AsyncWebParameter* p = getParam("mirror")) {
+      transform.setMirror(p->value().toInt() != 0);
+      updated = true;
+    }
+    if (const AsyncWebParameter* p = getParam("flip")) {
+      transform.setFlip(p->value().toInt() != 0);
+      updated = true;
+    }
+    if (const AsyncWebParameter* p = getParam("invert")) {
+      transform.setInvert(p->value().toInt() != 0);
+      updated = true;
+    }
+    const AsyncWebParameter* pdx = getParam("dx");
+    const AsyncWebParameter* pdy = getParam("dy");
+    if (pdx || pdy) {
+      transform.setOffset(pdx ? (int16_t)pdx->value().toInt() : transform.getOffsetX(),
+                          pdy ? (int16_t)pdy->value().toInt() : transform.getOffsetY());
+      updated = true;
+    }
+    if (!updated) {
+      sendError(request, 400, "no parameters provided");
+      return;
+    }
+    Command command;
+    command.type = Command::Type::TRANSFORM;
+    command.payload.transform = transform;
+    if (!this->commands.push(command)) {
+      sendBusy(request);
+      return;
+    }
+    sendTransform(request, transform);
   });
 
+  if (this->playlist) {
+    // GET /playlist -> {"running":..,"index":..,"transition":"wipe","transitionMs":..,"entries":[{"id":..,"duration":ms}]}
+    asyncWebServer->on("/playlist", HTTP_GET, [this](AsyncWebServerRequest *request) {
+      const State& state = this->published.read();
+      sendPlaylist(request, state.playlistEntries, state.playlistCount, state.playlistRunning, state.playlistIndex,
+                   state.transition, state.transitionMs);
+    });
+
+    // PUT /playlist?entries=clock:60000,snow:30000&transition=none|wipe|dissolve|slide&transitionMs=..&running=0|1
+    // (also accepts body params). New entries restart a running playlist.
+    asyncWebServer->on("/playlist", HTTP_PUT, [this](AsyncWebServerRequest *request) {
+      auto getParam = [&](const char* name) -> const AsyncWebParameter* {
+        if (request->hasParam(name)) {return request->getParam(name);}
+        if (request->hasParam(name, true)) {return request->getParam(name, true);}
+        return nullptr;
+      };
+      const AsyncWebParameter* pEntries = getParam("entries");
+      const AsyncWebParameter* pTransition = getParam("transition");
+      const AsyncWebParameter* pTransitionMs = getParam("transitionMs");
+      const AsyncWebParameter* pRunning = getParam("running");
+      if (!pEntries && !pTransition && !pTransitionMs && !pRunning) {
+        sendError(request, 400, "no parameters provided");
+        return;
+      }
+
+      const State& state = this->published.read();
+      Command command;
+      command.type = Command::Type::PLAYLIST;
+      auto& change = command.payload.playlist;
+      change.replaceEntries = pEntries != nullptr;
+      if (pEntries) {
+        const int entryCount = parsePlaylistEntries(pEntries->value().c_str(), change.entries);
+        if (entryCount < 0) {
+          sendError(request, 400, "invalid entries");
+          return;
+        }
+        change.count = (uint8_t)entryCount;
+      } else {
+        change.count = state.playlistCount;
+        memcpy(change.entries, state.playlistEntries, sizeof(change.entries));
+      }
+      change.transition = state.transition;
+      if (pTransition && !Playlist::parseTransition(pTransition->value().c_str(), &change.transition)) {
+        sendError(request, 400, "unknown transition");
+        return;
+      }
+      change.transitionMs = state.transitionMs;
+      if (pTransitionMs) {
+        change.transitionMs = strtoul(pTransitionMs->value().c_str(), nullptr, 10);
+        if (change.transitionMs > Playlist::MAX_TRANSITION_MS) {
+          change.transitionMs = Playlist::MAX_TRANSITION_MS;
+        }
+      }
+      change.running = pRunning ? (int8_t)(pRunning->value().toInt() != 0) : (int8_t)-1;
+
+      // Predict the state applyCommands() leaves behind for the response
+      const bool wasRunning = state.playlistRunning;
+      const bool run = pRunning ? change.running != 0 : wasRunning;
+      const bool restart = run && (pEntries || !wasRunning);
+      if (restart && change.count == 0) {
+        sendError(request, 409, "playlist is empty");
+        return;
+      }
+      if (!this->commands.push(command)) {
+        sendBusy(request);
+        return;
+      }
+      const uint8_t index = restart || pEntries ? 0 : state.playlistIndex;
+      sendPlaylist(request, change.entries, change.count, run, index, change.transition, change.transitionMs);
+    });
+
+    // DELETE /playlist -> stop and remove every entry
+    asyncWebServer->on("/playlist", HTTP_DELETE, [this](AsyncWebServerRequest *request) {
+      Command command;
+      command.type = Command::Type::CLEAR_PLAYLIST;
+      if (!this->commands.push(command)) {
+        sendBusy(request);
+        return;
+      }
+      const State& state = this->published.read();
+      sendPlaylist(request, nullptr, 0, false, 0, state.transition, state.transitionMs);
+    });
+  }
+
+  // The layers as they are now; handlers edit the copy to answer with the
+  // state their queued change leads to
+  auto currentLayers = [this](const VisualizationDefinition** definitions, RasterOp* ops) {
+    const State& state = this->published.read();
+    memcpy(definitions, state.layerDefinitions, sizeof(state.layerDefinitions));
+    memcpy(ops, state.layerOps, sizeof(state.layerOps));
+  };
+
+  if (this->compositor) {
+    // GET /layers -> {"layers":[{"index":0,"id":"clock"|null,"op":"or"},...]}
+    asyncWebServer->on("/layers", HTTP_GET, [currentLayers](AsyncWebServerRequest *request) {
+      const VisualizationDefinition* definitions[Compositor::MAX_LAYERS];
+      RasterOp ops[Compositor::MAX_LAYERS];
+      currentLayers(definitions, ops);
+      sendLayers(request, definitions, ops);
+    });
+
+    // PUT /layers?index=0&id=clock&op=copy|or|xor|mask (also accepts body params).
+    // A new id starts a fresh instance on that layer; op alone only changes
+    // how the layer is combined.
+    asyncWebServer->on("/layers", HTTP_PUT, [this, currentLayers](AsyncWebServerRequest *request) {
+      auto getParam = [&](const char* name) -> const AsyncWebParameter* {
+        if (request->hasParam(name)) {return request->getParam(name);}
+        if (request->hasParam(name, true)) {return request->getParam(name, true);}
+        return nullptr;
+      };
+      const AsyncWebParameter* pIndex = getParam("index");
+      const AsyncWebParameter* pId = getParam("id");
+      const AsyncWebParameter* pOp = getParam("op");
+      if (!pIndex) {
+        sendError(request, 400, "index is required");
+        return;
+      }
+      long index = pIndex->value().toInt();
+      if (index < 0 || index >= Compositor::MAX_LAYERS) {
+        sendError(request, 400, "index out of range");
+        return;
+      }
+      const VisualizationDefinition* definitions[Compositor::MAX_LAYERS];
+      RasterOp ops[Compositor::MAX_LAYERS];
+      currentLayers(definitions, ops);
+      if (pOp && !Compositor::parseOp(pOp->value().c_str(), &ops[index])) {
+        sendError(request, 400, "unknown op");
+        return;
+      }
+      Command command;
+      command.payload.layer.index = (uint8_t)index;
+      command.payload.layer.op = ops[index];
+      if (pId) {
+        const VisualizationDefinition* definition = findVisualization(pId->value().c_str());
+        if (!definition) {
+          sendError(request, 404, "visualization not found");
+          return;
+        }
+        command.type = Command::Type::SET_LAYER;
+        command.payload.layer.definition = definition;
+        definitions[index] = definition;
+      } else if (pOp) {
+        command.type = Command::Type::SET_LAYER_OP;
+        command.payload.layer.definition = nullptr;
+      } else {
+        sendError(request, 400, "id or op is required");
+        return;
+      }
+      if (!this->commands.push(command)) {
+        sendBusy(request);
+        return;
+      }
+      sendLayers(request, definitions, ops);
+    });
+
+    // DELETE /layers?index=0 clears one layer; without index, all of them
+    asyncWebServer->on("/layers", HTTP_DELETE, [this, currentLayers](AsyncWebServerRequest *request) {
+      const AsyncWebParameter* pIndex = nullptr;
+      if (request->hasParam("index")) {
+        pIndex = request->getParam("index");
+      } else if (request->hasParam("index", true)) {
+        pIndex = request->getParam("index", true);
+      }
+      const VisualizationDefinition* definitions[Compositor::MAX_LAYERS];
+      RasterOp ops[Compositor::MAX_LAYERS];
+      currentLayers(definitions, ops);
+      Command command;
+      if (pIndex) {
+        long index = pIndex->value().toInt();
+        if (index < 0 || index >= Compositor::MAX_LAYERS) {
+          sendError(request, 400, "index out of range");
+          return;
+        }
+        command.type = Command::Type::CLEAR_LAYER;
+        command.payload.layer.index = (uint8_t)index;
+        definitions[index] = nullptr;
+      } else {
+        command.type = Command::Type::CLEAR_LAYERS;
+        for (uint8_t i = 0; i < Compositor::MAX_LAYERS; ++i) {
+          definitions[i] = nullptr;
+        }
+      }
+      if (!this->commands.push(command)) {
+        sendBusy(request);
+        return;
+      }
+      sendLayers(request, definitions, ops);
+    });
+  }
+
+  publishState();
   asyncWebServer->begin();
   Serial.println("HTTP server started");
 }
+
+Visualization* WebServer::activeInstance(const VisualizationDefinition* definition) const {
+  if (!getCurrentVisualizationIdCallback || !getCurrentVisualizationCallback) {
+    return nullptr;
+  }
+  // Ids are handed out straight from the definitions table, so comparing
+  // the pointers identifies the definition without a string compare
+  if (getCurrentVisualizationIdCallback() != definition->id) {
+    return nullptr;
+  }
+  return getCurrentVisualizationCallback();
+}
+
+void WebServer::publishState() {
+  State& state = published.edit();
+  state.sequence = display->sequence();
+  for (uint8_t y = 0; y < Display::ROWS; y++) {
+    state.rows[y] = display->rowBits(y);
+  }
+  state.brightness = ledMatrix->intensity();
+  state.transform = ledMatrix->transform();
+
+  state.current = nullptr;
+  const char* id = getCurrentVisualizationIdCallback ? getCurrentVisualizationIdCallback() : nullptr;
+  for (size_t i = 0; i < visualizationDefinitionCount; i++) {
+    if (visualizationDefinitions[i].id == id) {
+      state.current = &visualizationDefinitions[i];
+      break;
+    }
+  }
+  state.configured = nullptr;
+  const Visualization* visualization = state.current ? activeInstance(state.current) : nullptr;
+  if (visualization && state.current->parameterCount > 0) {
+    state.configured = state.current;
+    size_t text = 0;
+    for (size_t i = 0; i < state.current->parameterCount; i++) {
+      const VisualizationParameter& parameter = state.current->parameters[i];
+      if (parameter.type == ParameterType::TEXT) {
+        strncpy(state.texts[text], parameter.getText(visualization), Command::MAX_TEXT_LENGTH);
+        state.texts[text++][Command::MAX_TEXT_LENGTH] = '\0';
+      } else {
+        state.numbers[i] = parameter.getNumber(visualization);
+      }
+    }
+  }
+
+  state.playlistCount = 0;
+  state.playlistRunning = false;
+  state.playlistIndex = 0;
+  if (playlist) {
+    state.playlistCount = playlist->size();
+    for (uint8_t i = 0; i < state.playlistCount; ++i) {
+      state.playlistEntries[i] = *playlist->entry(i);
+    }
+    state.playlistRunning = playlist->running();
+    state.playlistIndex = playlist->currentIndex();
+    state.transition = playlist->getTransition();
+    state.transitionMs = playlist->getTransitionDuration();
+  }
+
+  for (uint8_t i = 0; i < Compositor::MAX_LAYERS; ++i) {
+    state.layerDefinitions[i] = compositor ? compositor->layerDefinition(i) : nullptr;
+    state.layerOps[i] = compositor ? compositor->layerOp(i) : RasterOp::COPY;
+  }
+  published.publish();
+}
+
+const char* WebServer::framePayload() {
+  char* out = eventPayload;
+  out += snprintf(out, sizeof(eventPayload), "%lu %u %u", (unsigned long)pushedSequence,
+                  (unsigned)Display::COLUMNS, (unsigned)Display::ROWS);
+  for (uint8_t y = 0; y < Display::ROWS; y++) {
+    *out++ = ' ';
+    out = writeHex(out, pushedRows[y]);
+  }
+  *out = '\0';
+  return eventPayload;
+}
+
+void WebServer::pushFrame(unsigned long now) {
+  // With nobody listening the baseline may go stale; it is refreshed when
+  // the frame for the next client is sent
+  if (!events || events->count() == 0) {
+    framePending = false;
+    return;
+  }
+  const uint32_t sequence = display->sequence();
+  if (framePending) {
+    // Broadcast, since a client cannot be addressed safely from here; the
+    // clients that already had the frame are just reset to it
+    framePending = false;
+    pushedSequence = sequence;
+    lastPush = now;
+    for (uint8_t y = 0; y < Display::ROWS; y++) {
+      pushedRows[y] = display->rowBits(y);
+    }
+    events->send(framePayload(), "frame", sequence);
+    return;
+  }
+  if (sequence == pushedSequence || now - lastPush < PUSH_INTERVAL_MS) {
+    return;
+  }
+  pushedSequence = sequence;
+  lastPush = now;
+
+  char* out = eventPayload;
+  out += snprintf(out, sizeof(eventPayload), "%lu", (unsigned long)sequence);
+  bool changed = false;
+  for (uint8_t y = 0; y < Display::ROWS; y++) {
+    const Display::Row row = display->rowBits(y);
+    if (row == pushedRows[y]) {
+      continue;
+    }
+    pushedRows[y] = row;
+    out += snprintf(out, eventPayload + sizeof(eventPayload) - out, " %u:", (unsigned)y);
+    out = writeHex(out, row);
+    changed = true;
+  }
+  *out = '\0';
+  // Serialized once; every client is sent the same message
+  if (changed) {
+    events->send(eventPayload, "delta", sequence);
+  }
+}
+
+unsigned long WebServer::msUntilPush(unsigned long now) const {
+  if (framePending) {
+    return 0;
+  }
+  if (!events || events->count() == 0 || display->sequence() == pushedSequence) {
+    return (unsigned long)-1;
+  }
+  const unsigned long elapsed = now - lastPush;
+  return elapsed >= PUSH_INTERVAL_MS ? 0 : PUSH_INTERVAL_MS - elapsed;
+}
+
+bool WebServer::queuePixelChanges(const PixelChange* changes, size_t count) {
+  if (count == 0) {
+    return true;
+  }
+  if (commands.available() == 0 || !pixelChanges.push(changes, count)) {
+    return false;
+  }
+  // Published after the changes it refers to
+  Command command;
+  command.type = Command::Type::PIXELS;
+  command.payload.pixels.count = (uint8_t)count;
+  commands.push(command);
+  return true;
+}
+
+void WebServer::applyCommands(unsigned long now) {
+  // Consecutive pixel commands are merged into one batch, so a burst of
+  // requests costs the visualization a single redraw
+  Display::Row masks[Display::ROWS] = {};
+  Display::Row bits[Display::ROWS] = {};
+  bool pixelsPending = false;
+  auto applyPixels = [&]() {
+    PixelChange batch[Display::ROWS];
+    size_t count = 0;
+    for (uint8_t y = 0; y < Display::ROWS; y++) {
+      if (masks[y]) {
+        batch[count++] = {y, masks[y], bits[y]};
+        masks[y] = 0;
+        bits[y] = 0;
+      }
+    }
+    applyPixelChanges(batch, count);
+    pixelsPending = false;
+  };
+
+  Command command;
+  while (commands.pop(command)) {
+    if (command.type == Command::Type::PIXELS) {
+      PixelChange change;
+      for (uint8_t i = 0; i < command.payload.pixels.count && pixelChanges.pop(change); i++) {
+        masks[change.y] |= change.mask;
+        bits[change.y] = (Display::Row)((bits[change.y] & ~change.mask) | (change.bits & change.mask));
+      }
+      pixelsPending = true;
+      continue;
+    }
+    // Keep the order in which the requests came in
+    if (pixelsPending) {
+      applyPixels();
+    }
+    applyCommand(command, now);
+  }
+  if (pixelsPending) {
+    applyPixels();
+  }
+}
+
+void WebServer::applyCommand(const Command& command, unsigned long now) {
+  switch (command.type) {
+    case Command::Type::PIXELS:
+      break;
+    case Command::Type::FILL:
+      display->fill(command.payload.on);
+      break;
+    case Command::Type::ACTIVATE:
+      // Picking a visualization by hand takes over from the playlist
+      if (playlist) {
+        playlist->stop();
+      }
+      setVisualizationCallback(command.payload.definition->id);
+      break;
+    case Command::Type::SET_NUMBER: {
+      // Another visualization may have been activated since the request
+      const VisualizationDefinition* definition = command.payload.number.definition;
+      if (Visualization* visualization = activeInstance(definition)) {
+        definition->parameters[command.payload.number.index].setNumber(visualization, command.payload.number.value);
+      }
+      break;
+    }
+    case Command::Type::SET_TEXT: {
+      const VisualizationDefinition* definition = command.payload.text.definition;
+      if (Visualization* visualization = activeInstance(definition)) {
+        definition->parameters[command.payload.text.index].setText(visualization, command.payload.text.value);
+      }
+      break;
+    }
+    case Command::Type::BRIGHTNESS:
+      ledMatrix->setIntensity(command.payload.brightness);
+      break;
+    case Command::Type::TRANSFORM:
+      ledMatrix->setTransform(command.payload.transform);
+      break;
+    case Command::Type::PLAYLIST: {
+      const auto& change = command.payload.playlist;
+      playlist->setTransition(change.transition, change.transitionMs);
+      bool run = playlist->running();
+      if (change.replaceEntries) {
+        playlist->clear();
+        for (uint8_t i = 0; i < change.count; ++i) {
+          playlist->add(change.entries[i].definition, change.entries[i].durationMs);
+        }
+      }
+      if (change.running >= 0) {
+        run = change.running != 0;
+      }
+      if (run && (change.replaceEntries || !playlist->running())) {
+        playlist->start(now);
+      } else if (!run) {
+        playlist->stop();
+      }
+      break;
+    }
+    case Command::Type::CLEAR_PLAYLIST:
+      playlist->clear();
+      break;
+    case Command::Type::SET_LAYER:
+      compositor->setLayer(command.payload.layer.index, command.payload.layer.definition, command.payload.layer.op);
+      break;
+    case Command::Type::SET_LAYER_OP:
+      compositor->setLayerOp(command.payload.layer.index, command.payload.layer.op);
+      break;
+    case Command::Type::CLEAR_LAYER:
+      compositor->clearLayer(command.payload.layer.index);
+      break;
+    case Command::Type::CLEAR_LAYERS:
+      compositor->clear();
+      break;
+    case Command::Type::SEND_FRAME:
+      framePending = true;
+      break;
+  }
+}
+
+void WebServer::applyPixelChanges(const PixelChange* changes, size_t count) {
+  Visualization* visualization = getCurrentVisualizationCallback ? getCurrentVisualizationCallback() : nullptr;
+  if (!visualization || !visualization->handlePixelChange(changes, count)) {
+    for (size_t i = 0; i < count; i++) {
+      display->applyRow(changes[i].y, changes[i].bits, changes[i].mask, RasterOp::COPY);
+    }
+  }
+}
@@ -1,6 +1,12 @@
 #pragma once
 
+#include "CommandQueue.h"
+#include "Compositor.h"
 #include "Display.h"
+#include "Playlist.h"
+#include "Snapshot.h"
+#include "Transform.h"
+#include "Visualization.h"
 #include "Visualizations.h"
 
 #include <stddef.h>
@@ -8,12 +14,15 @@
 class LedMatrix; // forward declaration
 
 class AsyncWebServer; // forward declaration
+class AsyncEventSource; // forward declaration
+class AsyncWebServerRequest; // forward declaration
 
 class WebServer {
 public:
     using VisualizationSetter = bool (*)(const char* id);
     using VisualizationGetter = const char* (*)();
     using VisualizationAccessor = Visualization* (*)();
+    using RequestObserver = void (*)();
 
     WebServer(Display* display,
               LedMatrix* ledMatrix,
@@ -21,8 +30,143 @@ public:
               size_t visualizationDefinitionCount,
               VisualizationSetter setVisualizationCallback,
               VisualizationGetter getCurrentVisualizationIdCallback,
-              VisualizationAccessor getCurrentVisualizationCallback);
+              VisualizationAccessor getCurrentVisualizationCallback,
+              Playlist* playlist = nullptr,
+              Compositor* compositor = nullptr,
+              RequestObserver requestCallback = nullptr);
+
+    // Frame updates are pushed to /events clients at most this often
+    static constexpr unsigned long PUSH_INTERVAL_MS = 50;
+
+    // Carry out the changes web requests queued since the previous call.
+    // Call from loop() before anything is checked or drawn.
+    void applyCommands(unsigned long now);
+
+    // Broadcast the rows that changed since the previous push to every
+    // /events client. Call from loop() after the frame was presented.
+    void pushFrame(unsigned long now);
+    // Milliseconds from `now` until pushFrame() has something to send
+    unsigned long msUntilPush(unsigned long now) const;
+
+    // Copy the state the handlers answer from: the presented frame,
+    // brightness, transform, current visualization and its parameters,
+    // playlist and layers. Call from loop() once the frame was presented.
+    void publishState();
+
 private:
+    // A change requested over HTTP. Handlers run in the network stack's
+    // context, so they only validate and queue it; loop() applies it through
+    // applyCommands(), where nothing is being drawn or iterated.
+    struct Command {
+        enum class Type : uint8_t {
+            // The next `pixels.count` entries of pixelChanges
+            PIXELS,
+            FILL,
+            ACTIVATE,
+            SET_NUMBER,
+            SET_TEXT,
+            BRIGHTNESS,
+            TRANSFORM,
+            PLAYLIST,
+            CLEAR_PLAYLIST,
+            SET_LAYER,
+            SET_LAYER_OP,
+            CLEAR_LAYER,
+            CLEAR_LAYERS,
+            // A client connected to /events and waits for its first frame
+            SEND_FRAME,
+        };
+
+        // Longest text parameter value that is carried over
+        static constexpr size_t MAX_TEXT_LENGTH = 64;
+
+        Type type;
+        union Payload {
+            // Transform has a constructor, so the union needs one
+            Payload() {}
+
+            struct {
+                uint8_t count;
+            } pixels;
+            bool on;
+            const VisualizationDefinition* definition;
+            struct {
+                const VisualizationDefinition* definition;
+                uint8_t index;
+                unsigned long value;
+            } number;
+            struct {
+                const VisualizationDefinition* definition;
+                uint8_t index;
+                char value[MAX_TEXT_LENGTH + 1];
+            } text;
+            uint8_t brightness;
+            Transform transform;
+            struct {
+                Playlist::Entry entries[Playlist::MAX_ENTRIES];
+                uint8_t count;
+                // False keeps the current entries
+                bool replaceEntries;
+                Playlist::Transition transition;
+                unsigned long transitionMs;
+                // -1 keeps the running state
+                int8_t running;
+            } playlist;
+            struct {
+                uint8_t index;
+                const VisualizationDefinition* definition;
+                RasterOp op;
+            } layer;
+        } payload;
+    };
+
+    // Room for a few requests between two loop() iterations; a full queue
+    // is answered with 503
+    static constexpr uint8_t COMMAND_QUEUE_SIZE = 8;
+    static constexpr uint8_t PIXEL_QUEUE_SIZE = 32;
+    static_assert(PIXEL_QUEUE_SIZE >= Display::ROWS, "a whole frame must fit into the pixel queue");
+
+    // What handlers read instead of the display, LED matrix, playlist,
+    // compositor and visualizations, which loop() may be changing while a
+    // request is handled. publishState() fills it in.
+    struct State {
+        // The front buffer
+        uint32_t sequence;
+        Display::Row rows[Display::ROWS];
+        uint8_t brightness;
+        Transform transform;
+        const VisualizationDefinition* current;
+        // The definition whose parameter values follow, nullptr if none:
+        // numbers[i] for a NUMBER parameter i, texts[k] for the k-th TEXT one
+        const VisualizationDefinition* configured;
+        unsigned long numbers[MAX_VISUALIZATION_PARAMETERS];
+        char texts[MAX_VISUALIZATION_TEXT_PARAMETERS][Command::MAX_TEXT_LENGTH + 1];
+        Playlist::Entry playlistEntries[Playlist::MAX_ENTRIES];
+        uint8_t playlistCount;
+        bool playlistRunning;
+        uint8_t playlistIndex;
+        Playlist::Transition transition;
+        unsigned long transitionMs;
+        const VisualizationDefinition* layerDefinitions[Compositor::MAX_LAYERS];
+        RasterOp layerOps[Compositor::MAX_LAYERS];
+    };
+
+    // Queue `changes` as one PIXELS command; false if there is no room
+    bool queuePixelChanges(const PixelChange* changes, size_t count);
+
+    // Longest /events payload: a header plus one entry per row
+    static constexpr size_t EVENT_PAYLOAD_SIZE = 32 + Display::ROWS * (6 + 2 * sizeof(Display::Row));
+
+    // The running instance of `definition`, or nullptr while another
+    // visualization is current
+    Visualization* activeInstance(const VisualizationDefinition* definition) const;
+    void applyCommand(const Command& command, unsigned long now);
+    // Hand `changes` to the current visualization in one call, or apply them
+    // to the display if it takes no pixel input
+    void applyPixelChanges(const PixelChange* changes, size_t count);
+    // Serialize pushedRows as a "frame" event payload into eventPayload
+    const char* framePayload();
+
     Display* display;
     LedMatrix* ledMatrix;
     AsyncWebServer* asyncWebServer;
@@ -31,4 +175,25 @@ private:
     VisualizationSetter setVisualizationCallback;
     VisualizationGetter getCurrentVisualizationIdCallback;
     VisualizationAccessor getCurrentVisualizationCallback;
+    Playlist* playlist;
+    Compositor* compositor;
+    RequestObserver requestCallback;
+
+    CommandQueue<Command, COMMAND_QUEUE_SIZE> commands;
+    CommandQueue<PixelChange, PIXEL_QUEUE_SIZE> pixelChanges;
+    Snapshot<State> published;
+
+    AsyncEventSource* events;
+    // The frame /events clients hold: the last one pushed
+    Display::Row pushedRows[Display::ROWS];
+    uint32_t pushedSequence;
+    unsigned long lastPush;
+    // Set by SEND_FRAME: the next pushFrame() sends the whole frame
+    bool framePending;
+    char eventPayload[EVENT_PAYLOAD_SIZE];
+    // Raw PUT /display/frame body, collected for the request that owns it
+    uint8_t frameBody[Display::ROWS * sizeof(Display::Row)];
+    AsyncWebServerRequest* frameBodyOwner;
+    // Random per boot; Display::sequence() restarts at zero on every boot
+    uint32_t bootId;
 };
@@ -19,6 +19,9 @@
 #include "Text.h"
 #include "Visualization.h"
 #include "Visualizations.h"
+#include "Compositor.h"
+#include "Playlist.h"
+#include "Scheduler.h"
 
 #include "WebServer.h"
 
@@ -26,14 +29,24 @@
 LedMatrix* ledMatrix;
 Display* display;
 Visualization* currentVisualization;
+Playlist* playlist;
+Compositor* compositor;
 
 const VisualizationDefinition* visualizationDefinitions = nullptr;
 size_t visualizationDefinitionCount = 0;
 const VisualizationDefinition* currentVisualizationDefinition = nullptr;
 
 WebServer* webServer;
+Scheduler scheduler;
+
+// mDNS and other periodic upkeep that does not need to run every pass
+constexpr unsigned long HOUSEKEEPING_INTERVAL_MS = 100;
+constexpr unsigned long WAKEUP_REPORT_INTERVAL_MS = 60000;
+unsigned long lastHousekeeping = 0;
+unsigned long lastWakeupReport = 0;
 
 bool setCurrentVisualizationById(const char* id);
+void wakeLoop();
 const char* getCurrentVisualizationId();
 Visualization* getCurrentVisualizationInstance();
 
@@ -48,19 +61,17 @@ bool setCurrentVisualizationById(const char* id) {
     return true;
   }
 
-  Visualization* visualization = createVisualization(definition, display);
-  if (!visualization) {
+  // Clear before switching so whatever the new visualization draws up front
+  // survives. The previous one stays resident and keeps its state; a
+  // resumed one redraws itself.
+  display->clear();
+  currentVisualization = activateVisualization(definition, display);
+  currentVisualizationDefinition = definition;
+  if (!currentVisualization) {
     Serial.print("Failed to create visualization: ");
     Serial.println(definition->id);
     return false;
   }
-
-  if (currentVisualization != nullptr) {
-    delete currentVisualization;
-  }
-  display->clear();
-  currentVisualization = visualization;
-  currentVisualizationDefinition = definition;
   Serial.print("Visualization set to ");
   Serial.println(definition->id);
   return true;
@@ -77,6 +88,10 @@ Visualization* getCurrentVisualizationInstance() {
   return currentVisualization;
 }
 
+void wakeLoop() {
+  scheduler.wake();
+}
+
 void connectToWiFi(void) {
   WiFi.mode(WIFI_STA);
   #ifdef HOSTNAME
@@ -120,26 +135,59 @@ void setup() {
 
   ledMatrix = new LedMatrix();
   display = new Display();
+  playlist = new Playlist(display, setCurrentVisualizationById);
+  compositor = new Compositor(display);
   visualizationDefinitions = availableVisualizations(&visualizationDefinitionCount);
   currentVisualizationDefinition = defaultVisualization();
-  currentVisualization = createVisualization(currentVisualizationDefinition, display);
+  currentVisualization = activateVisualization(currentVisualizationDefinition, display);
   if (currentVisualization == nullptr) {
     Serial.println("Failed to create default visualization");
   }
 
   connectToWiFi();
-  webServer = new WebServer(display, ledMatrix, visualizationDefinitions, visualizationDefinitionCount, setCurrentVisualizationById, getCurrentVisualizationId, getCurrentVisualizationInstance);
+  webServer = new WebServer(display, ledMatrix, visualizationDefinitions, visualizationDefinitionCount, setCurrentVisualizationById, getCurrentVisualizationId, getCurrentVisualizationInstance, playlist, compositor, wakeLoop);
 }
 
 void loop() {
   unsigned long now = millis();
+  scheduler.begin(now);
+  // Changes requested over the web since the previous iteration
+  webServer->applyCommands(now);
+  playlist->check(now);
   if (currentVisualization != NULL) {
     currentVisualization->check(now);
+    scheduler.dueIn(currentVisualization->msUntilDue(now));
   }
-  if (display->needsRefresh()) {
-    ledMatrix->set(display);
+  compositor->check(now);
+  scheduler.dueIn(compositor->msUntilDue(now));
+  // Publish whatever was drawn since the last iteration, with the overlay
+  // layers on top, as one complete frame. While a playlist transition runs
+  // it is blended with the outgoing frame.
+  playlist->present(now, compositor->compose());
+  scheduler.dueIn(playlist->msUntilDue(now));
+  webServer->pushFrame(now);
+  scheduler.dueIn(webServer->msUntilPush(now));
+  // What web requests see until the next iteration
+  webServer->publishState();
+  // Flush in small slices so a full redraw never blocks the rest of loop()
+  if (!ledMatrix->flushing() && ledMatrix->needsFlush(display)) {
+    ledMatrix->beginFlush(display);
   }
-  #if defined(ESP8266) && defined(HOSTNAME)
-    MDNS.update();
-  #endif
+  if (ledMatrix->flushStep()) {
+    scheduler.dueIn(0);
+  }
+  if (now - lastHousekeeping >= HOUSEKEEPING_INTERVAL_MS) {
+    lastHousekeeping = now;
+    #if defined(ESP8266) && defined(HOSTNAME)
+      MDNS.update();
+    #endif
+  }
+  scheduler.dueIn(HOUSEKEEPING_INTERVAL_MS - (now - lastHousekeeping));
+  if (now - lastWakeupReport >= WAKEUP_REPORT_INTERVAL_MS) {
+    lastWakeupReport = now;
+    Serial.print("Loop wakeups/s: ");
+    Serial.println(scheduler.wakeupsPerSecond());
+  }
+  // Sleep until the next deadline or until a web request changes something
+  scheduler.sleep();
 }
@@ -2,10 +2,12 @@
 'use strict';
 
 const express = require('express');
+const crypto = require('crypto');
 const path = require('path');
 
 const app = express();
 app.use(express.json());
+app.use(express.urlencoded({ extended: false }));
 
 const DEFAULT_COLS = parseInt(process.env.MOCK_LED_MATRIX_COLS || '32', 10);
 const DEFAULT_ROWS = parseInt(process.env.MOCK_LED_MATRIX_ROWS || '32', 10);
@@ -14,17 +16,60 @@ const MIN_BRIGHTNESS = 0;
 const MAX_BRIGHTNESS = 15;
 const PORT = parseInt(process.env.PORT || process.env.MOCK_LED_MATRIX_PORT || '4000', 10);
 
+// Mirrors the parameter tables in lib/Visualizations/Visualizations.cpp
 const visualizations = [
-  { id: 'clock', label: 'Clock' },
-  { id: 'columns', label: 'Columns' },
-  { id: 'text', label: 'Text' },
+  { id: 'clock', label: 'Clock', parameters: [] },
+  { id: 'columns', label: 'Columns', parameters: [] },
+  {
+    id: 'marquee',
+    label: 'Marquee',
+    parameters: [
+      { name: 'text', label: 'Text', help: 'Scrolled from right to left. Up to 64 characters.', type: 'text', maxLength: 64 },
+      { name: 'speed', label: 'Speed (ms)', help: 'Time per one-column step. Set 0 to pause.', type: 'number', min: 0, max: 1000, step: 10 },
+    ],
+  },
+  {
+    id: 'snow',
+    label: 'Snow',
+    parameters: [
+      { name: 'gravity', label: 'Gravity (ms)', help: 'Time between downward steps. Set 0 to freeze snow in place.', type: 'number', min: 0, max: 2000, step: 10 },
+      { name: 'snowRate', label: 'Snow Rate (ms)', help: 'Lower values create flakes more frequently. 0 disables new snow.', type: 'number', min: 0, max: 5000, step: 50 },
+      { name: 'meltRate', label: 'Melt Rate (ms)', help: 'Lower values melt faster. 0 disables melting.', type: 'number', min: 0, max: 10000, step: 100 },
+      { name: 'wind', label: 'Wind (%)', help: 'Chance that a falling flake drifts sideways.', type: 'number', min: 0, max: 100, step: 1 },
+      { name: 'seed', label: 'Seed', help: 'Restarts the random sequence.', type: 'number', min: 0, max: 4294967295, step: 1 },
+    ],
+  },
+  { id: 'text', label: 'Text', parameters: [] },
 ];
 
 let columns = Number.isFinite(DEFAULT_COLS) && DEFAULT_COLS > 0 ? DEFAULT_COLS : 32;
 let rows = Number.isFinite(DEFAULT_ROWS) && DEFAULT_ROWS > 0 ? DEFAULT_ROWS : 32;
 let framebuffer = Array.from({ length: rows }, () => 0);
+// Bumped on every framebuffer change, like Display::sequence()
+let frameSequence = 0;
+// Per-start nonce in the /display.bin ETag, so a restart that resets
+// frameSequence never matches a tag a client still holds
+const bootId = crypto.randomBytes(4).toString('hex');
+// /events push channel, same protocol and rate limit as WebServer::pushFrame()
+const PUSH_INTERVAL_MS = 50;
+const eventClients = new Set();
+let pushedRows = framebuffer.slice();
+let pushedSequence = frameSequence;
+let lastPush = 0;
+let pushTimer = null;
 let brightness = Math.max(MIN_BRIGHTNESS, Math.min(MAX_BRIGHTNESS, DEFAULT_BRIGHTNESS));
 let currentVisualization = visualizations[0].id;
+const configs = {
+  marquee: { text: 'HELLO', speed: 60 },
+  snow: { gravity: 50, snowRate: 250, meltRate: 4000, wind: 25, seed: 0x2545f491 },
+};
+const PLAYLIST_MAX_ENTRIES = 8;
+const PLAYLIST_TRANSITIONS = ['none', 'wipe', 'dissolve', 'slide'];
+let transform = { rotation: 0, mirror: false, flip: false, invert: false, dx: 0, dy: 0 };
+const MAX_LAYERS = 3;
+const LAYER_OPS = ['copy', 'or', 'xor', 'mask'];
+let layers = Array.from({ length: MAX_LAYERS }, (_, index) => ({ index, id: null, op: 'or' }));
+let playlist = { running: false, index: 0, transition: 'wipe', transitionMs: 600, entries: [] };
 
 function setPixel(x, y, on) {
   if (x < 0 || y < 0 || x >= columns || y >= rows) {
@@ -37,16 +82,58 @@ function setPixel(x, y, on) {
   } else {
     framebuffer[y] = before & ~mask;
   }
-  return framebuffer[y] !== before;
+  if (framebuffer[y] === before) {
+    return false;
+  }
+  frameChanged();
+  return true;
 }
 
 function fillDisplay(on) {
   const value = on ? ((columns >= 32 ? 0xFFFFFFFF : (1 << columns) - 1)) : 0;
   framebuffer = Array.from({ length: rows }, () => value);
+  frameChanged();
 }
 
 function resetDisplay() {
   framebuffer = Array.from({ length: rows }, () => 0);
+  frameChanged();
+}
+
+function frameChanged() {
+  frameSequence++;
+  if (pushTimer || eventClients.size === 0) {
+    return;
+  }
+  pushTimer = setTimeout(pushFrame, Math.max(0, PUSH_INTERVAL_MS - (Date.now() - lastPush)));
+}
+
+function rowHex(value) {
+  return (columns <= 32 ? value >>> 0 : value).toString(16);
+}
+
+function sendEvent(res, event, id, data) {
+  res.write(`event: ${event}\nid: ${id}\ndata: ${data}\n\n`);
+}
+
+function pushFrame() {
+  pushTimer = null;
+  lastPush = Date.now();
+  if (frameSequence === pushedSequence) {
+    return;
+  }
+  pushedSequence = frameSequence;
+  const entries = [];
+  framebuffer.forEach((value, y) => {
+    if (value !== pushedRows[y]) {
+      pushedRows[y] = value;
+      entries.push(`${y}:${rowHex(value)}`);
+    }
+  });
+  if (entries.length > 0) {
+    const data = [pushedSequence, ...entries].join(' ');
+    eventClients.forEach((client) => sendEvent(client, 'delta', pushedSequence, data));
+  }
 }
 
 function getParam(req, name) {
@@ -67,6 +154,39 @@ app.get('/display', (_req, res) => {
   res.json({ columns, rows, framebuffer });
 });
 
+app.get('/events', (req, res) => {
+  res.set({ 'Content-Type': 'text/event-stream', 'Cache-Control': 'no-cache', Connection: 'keep-alive' });
+  res.flushHeaders();
+  sendEvent(res, 'frame', pushedSequence, [pushedSequence, columns, rows, ...pushedRows.map(rowHex)].join(' '));
+  eventClients.add(res);
+  req.on('close', () => eventClients.delete(res));
+  // Changes made while nobody was listening
+  if (frameSequence !== pushedSequence && !pushTimer) {
+    pushTimer = setTimeout(pushFrame, 0);
+  }
+});
+
+// One little-endian row word per row (4 bytes up to 32 columns, else 8)
+app.get('/display.bin', (req, res) => {
+  const etag = `"${bootId}-${frameSequence}"`;
+  res.set('ETag', etag);
+  res.set('Cache-Control', 'no-cache');
+  if (req.get('If-None-Match') === etag) {
+    return res.status(304).end();
+  }
+  const wordBytes = columns <= 32 ? 4 : 8;
+  const body = Buffer.alloc(rows * wordBytes);
+  framebuffer.forEach((value, y) => {
+    body.writeUInt32LE(value >>> 0, y * wordBytes);
+    if (wordBytes === 8) {
+      body.writeUInt32LE(Math.floor(value / 2 ** 32) >>> 0, y * wordBytes + 4);
+    }
+  });
+  res.set('X-Columns', String(columns));
+  res.set('X-Rows', String(rows));
+  res.type('application/octet-stream').send(body);
+});
+
 app.put('/display', (req, res) => {
   const x = parseInt(getParam(req, 'x'), 10);
   const y = parseInt(getParam(req, 'y'), 10);
@@ -81,8 +201,49 @@ app.put('/display', (req, res) => {
     return res.status(400).json({ error: 'x or y out of range' });
   }
 
-  const changed = setPixel(x, y, on);
-  res.json({ x, y, on, changed });
+  setPixel(x, y, on);
+  res.json({ x, y, on });
+});
+
+// Pixel list "x,y,on;x,y,on;..." applied as a whole or not at all
+app.put('/display/pixels', (req, res) => {
+  const spec = getParam(req, 'pixels');
+  if (typeof spec === 'undefined') {
+    return res.status(400).json({ error: 'pixels is required' });
+  }
+  const entries = [];
+  for (const entry of String(spec).split(';').filter(Boolean)) {
+    const match = /^(\d+),(\d+),([01])$/.exec(entry);
+    if (!match || Number(match[1]) >= columns || Number(match[2]) >= rows) {
+      return res.status(400).json({ error: 'pixels must be x,y,0|1 entries separated by ; and on the display' });
+    }
+    entries.push([Number(match[1]), Number(match[2]), match[3] === '1']);
+  }
+  entries.forEach(([x, y, on]) => setPixel(x, y, on));
+  // Distinct pixels written, as the device counts them
+  res.json({ pixels: new Set(entries.map(([x, y]) => `${x},${y}`)).size });
+});
+
+// Whole frame in the /display.bin layout, raw or base64 in `frame`
+app.put('/display/frame', express.raw({ type: 'application/octet-stream', limit: '4kb' }), (req, res) => {
+  const wordBytes = columns <= 32 ? 4 : 8;
+  let frame = Buffer.isBuffer(req.body) ? req.body : null;
+  if (!frame) {
+    const encoded = getParam(req, 'frame');
+    frame = typeof encoded === 'string' ? Buffer.from(encoded, 'base64') : null;
+  }
+  if (!frame || frame.length !== rows * wordBytes) {
+    return res.status(400).json({ error: `frame must be ${rows * wordBytes} bytes of little-endian row masks, raw or base64` });
+  }
+  const fullRow = columns >= 32 ? 0xFFFFFFFF : (1 << columns) - 1;
+  framebuffer = Array.from({ length: rows }, (_, y) => {
+    if (wordBytes === 8) {
+      return frame.readUInt32LE(y * wordBytes) + frame.readUInt32LE(y * wordBytes + 4) * 2 ** 32;
+    }
+    return frame.readUInt32LE(y * wordBytes) & fullRow;
+  });
+  frameChanged();
+  res.json({ pixels: columns * rows });
 });
 
 app.post('/display/fill', (req, res) => {
@@ -129,10 +290,214 @@ app.post('/visualizations', (req, res) => {
   if (!found) {
     return res.status(404).json({ error: 'visualization not found' });
   }
+  // Picking a visualization by hand takes over from the playlist
+  playlist.running = false;
   currentVisualization = id;
   res.json({ current: currentVisualization });
 });
 
+function parsePlaylistEntries(spec) {
+  if (spec === '') {
+    return [];
+  }
+  const entries = [];
+  for (const part of spec.split(',')) {
+    const match = /^([^:]+):(\d+)$/.exec(part);
+    if (!match || entries.length >= PLAYLIST_MAX_ENTRIES) {
+      return null;
+    }
+    const duration = parseInt(match[2], 10);
+    if (!visualizations.some((viz) => viz.id === match[1]) || duration <= 0) {
+      return null;
+    }
+    entries.push({ id: match[1], duration });
+  }
+  return entries;
+}
+
+app.get('/playlist', (_req, res) => {
+  res.json(playlist);
+});
+
+app.put('/playlist', (req, res) => {
+  const entriesParam = getParam(req, 'entries');
+  const transition = getParam(req, 'transition');
+  const transitionMs = getParam(req, 'transitionMs');
+  const running = getParam(req, 'running');
+  if ([entriesParam, transition, transitionMs, running].every((value) => typeof value === 'undefined')) {
+    return res.status(400).json({ error: 'no parameters provided' });
+  }
+  let entries = null;
+  if (typeof entriesParam !== 'undefined') {
+    entries = parsePlaylistEntries(String(entriesParam));
+    if (!entries) {
+      return res.status(400).json({ error: 'invalid entries' });
+    }
+  }
+  if (typeof transition !== 'undefined' && !PLAYLIST_TRANSITIONS.includes(String(transition))) {
+    return res.status(400).json({ error: 'unknown transition' });
+  }
+  if (typeof transition !== 'undefined') {
+    playlist.transition = String(transition);
+  }
+  if (typeof transitionMs !== 'undefined') {
+    const value = Math.trunc(Number(transitionMs));
+    playlist.transitionMs = Number.isFinite(value) && value > 0 ? Math.min(value, 60000) : 0;
+  }
+  let run = playlist.running;
+  if (entries) {
+    playlist.entries = entries;
+    playlist.running = false;
+  }
+  if (typeof running !== 'undefined') {
+    run = Math.trunc(Number(running)) !== 0;
+  }
+  if (run && !playlist.running) {
+    if (playlist.entries.length === 0) {
+      return res.status(409).json({ error: 'playlist is empty' });
+    }
+    playlist.running = true;
+    playlist.index = 0;
+    currentVisualization = playlist.entries[0].id;
+  } else if (!run) {
+    playlist.running = false;
+  }
+  res.json(playlist);
+});
+
+function transformJson() {
+  return { ...transform, quarterTurns: columns === rows };
+}
+
+function wrap(value, size) {
+  return ((value % size) + size) % size;
+}
+
+app.get('/transform', (_req, res) => {
+  res.json(transformJson());
+});
+
+app.put('/transform', (req, res) => {
+  const names = ['rotation', 'mirror', 'flip', 'invert', 'dx', 'dy'];
+  const params = Object.fromEntries(names.map((name) => [name, getParam(req, name)]));
+  if (names.every((name) => typeof params[name] === 'undefined')) {
+    return res.status(400).json({ error: 'no parameters provided' });
+  }
+  const next = { ...transform };
+  if (typeof params.rotation !== 'undefined') {
+    const rotation = Math.trunc(Number(params.rotation));
+    if (![0, 90, 180, 270].includes(rotation)) {
+      return res.status(400).json({ error: 'rotation must be 0, 90, 180 or 270' });
+    }
+    if ((rotation === 90 || rotation === 270) && columns !== rows) {
+      return res.status(400).json({ error: 'quarter turns need a square panel' });
+    }
+    next.rotation = rotation;
+  }
+  ['mirror', 'flip', 'invert'].forEach((name) => {
+    if (typeof params[name] !== 'undefined') {
+      next[name] = Math.trunc(Number(params[name])) !== 0;
+    }
+  });
+  if (typeof params.dx !== 'undefined') {
+    next.dx = wrap(Math.trunc(Number(params.dx)) || 0, columns);
+  }
+  if (typeof params.dy !== 'undefined') {
+    next.dy = wrap(Math.trunc(Number(params.dy)) || 0, rows);
+  }
+  transform = next;
+  res.json(transformJson());
+});
+
+app.get('/layers', (_req, res) => {
+  res.json({ layers });
+});
+
+app.put('/layers', (req, res) => {
+  const indexParam = getParam(req, 'index');
+  const id = getParam(req, 'id');
+  const op = getParam(req, 'op');
+  if (typeof indexParam === 'undefined') {
+    return res.status(400).json({ error: 'index is required' });
+  }
+  const index = Math.trunc(Number(indexParam));
+  if (!Number.isFinite(index) || index < 0 || index >= MAX_LAYERS) {
+    return res.status(400).json({ error: 'index out of range' });
+  }
+  if (typeof op !== 'undefined' && !LAYER_OPS.includes(String(op))) {
+    return res.status(400).json({ error: 'unknown op' });
+  }
+  if (typeof id === 'undefined' && typeof op === 'undefined') {
+    return res.status(400).json({ error: 'id or op is required' });
+  }
+  if (typeof id !== 'undefined' && !visualizations.some((viz) => viz.id === String(id))) {
+    return res.status(404).json({ error: 'visualization not found' });
+  }
+  if (typeof id !== 'undefined') {
+    layers[index].id = String(id);
+  }
+  if (typeof op !== 'undefined') {
+    layers[index].op = String(op);
+  }
+  res.json({ layers });
+});
+
+app.delete('/layers', (req, res) => {
+  const indexParam = getParam(req, 'index');
+  if (typeof indexParam === 'undefined') {
+    layers = layers.map((layer) => ({ ...layer, id: null }));
+    return res.json({ layers });
+  }
+  const index = Math.trunc(Number(indexParam));
+  if (!Number.isFinite(index) || index < 0 || index >= MAX_LAYERS) {
+    return res.status(400).json({ error: 'index out of range' });
+  }
+  layers[index].id = null;
+  res.json({ layers });
+});
+
+app.delete('/playlist', (_req, res) => {
+  playlist = { ...playlist, running: false, index: 0, entries: [] };
+  res.json(playlist);
+});
+
+visualizations
+  .filter((viz) => viz.parameters.length > 0)
+  .forEach((viz) => {
+    const inactive = (res) => res.status(409).json({ error: `${viz.id} visualization inactive` });
+
+    app.get(`/visualizations/${viz.id}/config`, (_req, res) => {
+      if (currentVisualization !== viz.id) {
+        return inactive(res);
+      }
+      res.json(configs[viz.id]);
+    });
+
+    app.put(`/visualizations/${viz.id}/config`, (req, res) => {
+      if (currentVisualization !== viz.id) {
+        return inactive(res);
+      }
+      let updated = false;
+      viz.parameters.forEach((param) => {
+        const value = getParam(req, param.name);
+        if (typeof value === 'undefined') {
+          return;
+        }
+        if (param.type === 'text') {
+          configs[viz.id][param.name] = String(value).slice(0, param.maxLength);
+        } else {
+          const number = Math.trunc(Number(value));
+          configs[viz.id][param.name] = Math.min(param.max, Math.max(param.min, Number.isFinite(number) ? number : 0));
+        }
+        updated = true;
+      });
+      if (!updated) {
+        return res.status(400).json({ error: 'no parameters provided' });
+      }
+      res.json(configs[viz.id]);
+    });
+  });
+
 const staticRoot = path.resolve(__dirname, '../../data');
 app.use('/', express.static(staticRoot));
 
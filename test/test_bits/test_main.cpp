@@ -0,0 +1,151 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <random>
+#include <stdio.h>
+#include <string.h>
+
+#include "Bits.h"
+#include "Display.h"
+#include "Max7219.h"
+
+namespace {
+
+constexpr uint8_t DEVICES_PER_BAND = Display::COLUMNS / 8;
+constexpr uint8_t DEVICES = DEVICES_PER_BAND * Display::BANDS;
+
+// Reference for transpose8x8: bit by bit, in its MSB-first convention
+void naiveTranspose(const uint8_t in[8], uint8_t out[8]) {
+  for (uint8_t c = 0; c < 8; ++c) {
+    out[c] = 0;
+    for (uint8_t r = 0; r < 8; ++r) {
+      if (in[r] & (0x80 >> c)) {
+        out[c] |= (uint8_t)(0x80 >> r);
+      }
+    }
+  }
+}
+
+// Digit registers of every device the way LedMatrix used to build them:
+// one getPixel() per pixel. Digit d of a device is its column d, with the
+// device's top row in the most significant bit.
+void registersPerPixel(Display& display, uint8_t registers[Max7219::DIGITS][DEVICES]) {
+  for (uint8_t device = 0; device < DEVICES; ++device) {
+    const uint8_t x0 = (uint8_t)(device % DEVICES_PER_BAND * 8);
+    const uint8_t y0 = (uint8_t)(device / DEVICES_PER_BAND * 8);
+    for (uint8_t digit = 0; digit < Max7219::DIGITS; ++digit) {
+      uint8_t value = 0;
+      for (uint8_t r = 0; r < 8; ++r) {
+        if (display.getPixel((uint8_t)(x0 + digit), (uint8_t)(y0 + r))) {
+          value |= (uint8_t)(0x80 >> r);
+        }
+      }
+      registers[digit][device] = value;
+    }
+  }
+}
+
+// The same registers from whole row masks with one transpose per device,
+// as LedMatrix::beginFlush() does
+void registersTransposed(const Display& display, uint8_t registers[Max7219::DIGITS][DEVICES]) {
+  for (uint8_t device = 0; device < DEVICES; ++device) {
+    const uint8_t block = device % DEVICES_PER_BAND;
+    const uint8_t band = device / DEVICES_PER_BAND;
+    uint8_t rows[8];
+    uint8_t columns[8];
+    for (uint8_t y = 0; y < 8; ++y) {
+      rows[y] = (uint8_t)(display.rowBits((uint8_t)(band * 8 + y)) >> (block * 8));
+    }
+    Bits::transpose8x8(rows, columns);
+    for (uint8_t digit = 0; digit < Max7219::DIGITS; ++digit) {
+      registers[digit][device] = columns[7 - digit];
+    }
+  }
+}
+
+void randomize(Display& display, std::mt19937& random) {
+  for (uint8_t y = 0; y < Display::ROWS; ++y) {
+    const uint64_t bits = (uint64_t)random() << 32 | random();
+    for (uint8_t x = 0; x < Display::COLUMNS; ++x) {
+      display.setPixel(x, y, (bits >> x) & 1);
+    }
+  }
+  display.present();
+}
+
+TEST(Transpose8x8, MatchesBitByBitTranspose) {
+  std::mt19937 random(1);
+  for (int i = 0; i < 100000; ++i) {
+    uint8_t in[8];
+    for (uint8_t& row : in) {
+      row = (uint8_t)random();
+    }
+    uint8_t expected[8];
+    uint8_t actual[8];
+    naiveTranspose(in, expected);
+    Bits::transpose8x8(in, actual);
+    ASSERT_EQ(0, memcmp(expected, actual, sizeof(expected))) << "pattern " << i;
+  }
+}
+
+TEST(Transpose8x8, MovesEverySingleBit) {
+  for (uint8_t r = 0; r < 8; ++r) {
+    for (uint8_t c = 0; c < 8; ++c) {
+      uint8_t in[8] = {};
+      in[r] = (uint8_t)(0x80 >> c);
+      uint8_t out[8];
+      Bits::transpose8x8(in, out);
+      for (uint8_t k = 0; k < 8; ++k) {
+        EXPECT_EQ(out[k], k == c ? (uint8_t)(0x80 >> r) : 0);
+      }
+    }
+  }
+}
+
+TEST(Transpose8x8, DeviceRegistersMatchPerPixelPath) {
+  std::mt19937 random(2);
+  Display display;
+  for (int i = 0; i < 1000; ++i) {
+    randomize(display, random);
+    uint8_t expected[Max7219::DIGITS][DEVICES];
+    uint8_t actual[Max7219::DIGITS][DEVICES];
+    registersPerPixel(display, expected);
+    registersTransposed(display, actual);
+    ASSERT_EQ(0, memcmp(expected, actual, sizeof(expected))) << "frame " << i;
+  }
+}
+
+TEST(Transpose8x8, Benchmark) {
+  using Clock = std::chrono::steady_clock;
+  constexpr int FRAMES = 20000;
+  std::mt19937 random(3);
+  Display display;
+  randomize(display, random);
+  uint8_t registers[Max7219::DIGITS][DEVICES];
+  volatile uint8_t sink = 0;
+
+  auto start = Clock::now();
+  for (int i = 0; i < FRAMES; ++i) {
+    registersPerPixel(display, registers);
+    sink = (uint8_t)(sink ^ registers[i % Max7219::DIGITS][0]);
+  }
+  const double perPixel = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / FRAMES;
+
+  start = Clock::now();
+  for (int i = 0; i < FRAMES; ++i) {
+    registersTransposed(display, registers);
+    sink = (uint8_t)(sink ^ registers[i % Max7219::DIGITS][0]);
+  }
+  const double transposed = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / FRAMES;
+
+  printf("digit registers for a %ux%u frame\n", (unsigned)Display::COLUMNS, (unsigned)Display::ROWS);
+  printf("  getPixel loop   %8.0f ns\n", perPixel);
+  printf("  transpose8x8    %8.0f ns\n", transposed);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,165 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <stdint.h>
+#include <thread>
+
+#include "CommandQueue.h"
+
+namespace {
+
+// One queued item: a running number and where it sits in its push() batch
+struct Item {
+  uint32_t sequence;
+  uint8_t index;
+  uint8_t batch;
+};
+
+TEST(CommandQueue, PopsInPushOrder) {
+  CommandQueue<int, 8> queue;
+  EXPECT_TRUE(queue.empty());
+  EXPECT_EQ(queue.available(), 8u);
+  for (int i = 0; i < 5; ++i) {
+    ASSERT_TRUE(queue.push(i));
+  }
+  EXPECT_FALSE(queue.empty());
+  EXPECT_EQ(queue.available(), 3u);
+  for (int i = 0; i < 5; ++i) {
+    int item = -1;
+    ASSERT_TRUE(queue.pop(item));
+    EXPECT_EQ(item, i);
+  }
+  int item = -1;
+  EXPECT_FALSE(queue.pop(item));
+  EXPECT_EQ(item, -1);
+  EXPECT_TRUE(queue.empty());
+}
+
+TEST(CommandQueue, BatchIsAllOrNothing) {
+  CommandQueue<int, 8> queue;
+  const int batch[9] = {0, 1, 2, 3, 4, 5, 6, 7, 8};
+  EXPECT_FALSE(queue.push(batch, 9));
+  EXPECT_TRUE(queue.empty());
+  ASSERT_TRUE(queue.push(batch, 8));
+  EXPECT_EQ(queue.available(), 0u);
+  EXPECT_FALSE(queue.push(batch, 1));
+  EXPECT_TRUE(queue.push(batch, 0));
+
+  int item = -1;
+  ASSERT_TRUE(queue.pop(item));
+  ASSERT_TRUE(queue.pop(item));
+  EXPECT_FALSE(queue.push(batch, 3));
+  ASSERT_TRUE(queue.push(batch, 2));
+  for (int expected : {2, 3, 4, 5, 6, 7, 0, 1}) {
+    ASSERT_TRUE(queue.pop(item));
+    EXPECT_EQ(item, expected);
+  }
+  EXPECT_TRUE(queue.empty());
+}
+
+// The positions are uint8_t and run past 255 many times here; the fill
+// level must stay right across every wrap, including with a full queue
+TEST(CommandQueue, FillLevelSurvivesIndexWrapAround) {
+  CommandQueue<uint32_t, 128> queue;
+  uint32_t pushed = 0;
+  uint32_t popped = 0;
+  for (int round = 0; round < 2000; ++round) {
+    const size_t count = (size_t)(round * 37 % 129);
+    uint32_t batch[128];
+    for (size_t i = 0; i < count; ++i) {
+      batch[i] = pushed + (uint32_t)i;
+    }
+    const size_t room = queue.available();
+    ASSERT_EQ(room, 128u - (pushed - popped));
+    if (queue.push(batch, count)) {
+      ASSERT_LE(count, room);
+      pushed += (uint32_t)count;
+    } else {
+      ASSERT_GT(count, room);
+      ASSERT_EQ(queue.available(), room) << "a rejected push must leave the queue as it was";
+    }
+    const uint32_t drain = (uint32_t)(round * 53 % 97);
+    for (uint32_t i = 0; i < drain && popped < pushed; ++i) {
+      uint32_t item = 0;
+      ASSERT_TRUE(queue.pop(item));
+      ASSERT_EQ(item, popped++);
+    }
+    ASSERT_EQ(queue.empty(), popped == pushed);
+  }
+  EXPECT_GT(pushed, 256u * 100);
+}
+
+// A producer thread pushes numbered batches of 1..Capacity items while the
+// consumer pops them. Every item must arrive once and in order, and a batch
+// must become visible as a whole: once its first item is popped the rest
+// are already there.
+template<uint8_t Capacity>
+void stress(uint32_t total) {
+  CommandQueue<Item, Capacity> queue;
+  std::atomic<bool> stop(false);
+  std::thread producer([&] {
+    uint32_t sequence = 0;
+    while (sequence < total && !stop.load()) {
+      Item items[Capacity];
+      const uint8_t count = (uint8_t)(sequence % Capacity + 1);
+      for (uint8_t i = 0; i < count; ++i) {
+        items[i] = {sequence + i, i, count};
+      }
+      if (queue.push(items, count)) {
+        sequence += count;
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  // A failed assertion returns early; the producer has to be joined anyway
+  struct Joiner {
+    ~Joiner() {
+      if (thread.joinable()) {
+        stop.store(true);
+        thread.join();
+      }
+    }
+    std::atomic<bool>& stop;
+    std::thread& thread;
+  } joiner{stop, producer};
+
+  uint32_t expected = 0;
+  while (expected < total) {
+    Item item;
+    if (!queue.pop(item)) {
+      std::this_thread::yield();
+      continue;
+    }
+    ASSERT_EQ(item.sequence, expected);
+    ASSERT_EQ(item.index, 0);
+    ++expected;
+    for (uint8_t i = 1; i < item.batch; ++i) {
+      Item next;
+      ASSERT_TRUE(queue.pop(next)) << "batch at " << item.sequence << " arrived in part";
+      ASSERT_EQ(next.sequence, expected);
+      ASSERT_EQ(next.index, i);
+      ++expected;
+    }
+  }
+  producer.join();
+  Item item;
+  EXPECT_FALSE(queue.pop(item));
+  EXPECT_TRUE(queue.empty());
+}
+
+TEST(CommandQueue, ProducerAndConsumerThreadsSmallQueue) {
+  stress<8>(200000);
+}
+
+TEST(CommandQueue, ProducerAndConsumerThreadsLargestQueue) {
+  stress<128>(200000);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
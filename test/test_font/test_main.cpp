@@ -0,0 +1,125 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+
+#include "Display.h"
+#include "Font.h"
+
+namespace {
+
+// Row masks straight from the column-major glyph definition
+template <uint8_t Width, uint8_t Height, typename Glyph>
+void transposeGlyph(const Glyph& glyph, uint8_t rows[Height]) {
+  for (uint8_t y = 0; y < Height; ++y) {
+    rows[y] = 0;
+    for (uint8_t x = 0; x < Width; ++x) {
+      if ((glyph.cols[x] >> y) & 0x01) {
+        rows[y] |= (uint8_t)(1U << x);
+      }
+    }
+  }
+}
+
+// Characters outside the atlas are drawn as '?'
+char inAtlas(char ch) {
+  return ch < Font3x5::FIRST_CHAR || ch > Font3x5::LAST_CHAR ? '?' : ch;
+}
+
+TEST(FontAtlas, Font3x5MatchesGlyphFor) {
+  for (int c = -128; c < 128; ++c) {
+    const char ch = (char)c;
+    uint8_t expected[Font3x5::HEIGHT];
+    uint8_t actual[Font3x5::HEIGHT];
+    transposeGlyph<Font3x5::WIDTH, Font3x5::HEIGHT>(Font3x5::glyphFor(inAtlas(ch)), expected);
+    Font3x5::rowsFor(ch, actual);
+    ASSERT_EQ(0, memcmp(expected, actual, sizeof(expected))) << "character " << c;
+  }
+}
+
+TEST(FontAtlas, Font4x6MatchesGlyphFor) {
+  for (int c = -128; c < 128; ++c) {
+    const char ch = (char)c;
+    uint8_t expected[Font4x6::HEIGHT];
+    uint8_t actual[Font4x6::HEIGHT];
+    transposeGlyph<Font4x6::WIDTH, Font4x6::HEIGHT>(Font4x6::glyphFor(inAtlas(ch)), expected);
+    Font4x6::rowsFor(ch, actual);
+    ASSERT_EQ(0, memcmp(expected, actual, sizeof(expected))) << "character " << c;
+  }
+}
+
+// String rendering before the atlas: the 4x6 glyph rescaled on every call
+// and drawn one setPixel() at a time
+void renderPerPixel(Display& display, const char* text) {
+  uint8_t x = 0;
+  for (const char* p = text; *p && x < Display::COLUMNS; ++p) {
+    const Font4x6::Glyph glyph = Font4x6::glyphFor(*p);
+    for (uint8_t cx = 0; cx < Font4x6::WIDTH; ++cx) {
+      for (uint8_t y = 0; y < Font4x6::HEIGHT; ++y) {
+        if ((glyph.cols[cx] >> y) & 0x01) {
+          display.setPixel((uint8_t)(x + cx), (uint8_t)(y + 1), true);
+        }
+      }
+    }
+    x = (uint8_t)(x + Font4x6::WIDTH + Font4x6::SPACING);
+  }
+}
+
+// As Text and Clock draw now: an atlas lookup and a row blit per character
+void renderAtlas(Display& display, const char* text) {
+  uint8_t x = 0;
+  for (const char* p = text; *p && x < Display::COLUMNS; ++p) {
+    uint8_t rows[Font4x6::HEIGHT];
+    Font4x6::rowsFor(*p, rows);
+    display.blit(x, 1, rows, Font4x6::WIDTH, Font4x6::HEIGHT, RasterOp::OR);
+    x = (uint8_t)(x + Font4x6::WIDTH + Font4x6::SPACING);
+  }
+}
+
+TEST(FontAtlas, RendersLikeThePerPixelPath) {
+  const char* samples[] = {"12:34", "HELLO", "snow?", "~{|}", "A-Z+0=9/"};
+  for (const char* text : samples) {
+    Display perPixel;
+    Display atlas;
+    renderPerPixel(perPixel, text);
+    renderAtlas(atlas, text);
+    for (uint8_t y = 0; y < Display::ROWS; ++y) {
+      ASSERT_EQ(perPixel.row(y), atlas.row(y)) << text << " row " << (int)y;
+    }
+  }
+}
+
+TEST(FontAtlas, Benchmark) {
+  using Clock = std::chrono::steady_clock;
+  constexpr int RENDERS = 50000;
+  const char* text = "12:34";
+  Display display;
+  volatile Display::Row sink = 0;
+
+  auto start = Clock::now();
+  for (int i = 0; i < RENDERS; ++i) {
+    display.clear();
+    renderPerPixel(display, text);
+    sink = (Display::Row)(sink ^ display.row(3));
+  }
+  const double perPixel = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / RENDERS;
+
+  start = Clock::now();
+  for (int i = 0; i < RENDERS; ++i) {
+    display.clear();
+    renderAtlas(display, text);
+    sink = (Display::Row)(sink ^ display.row(3));
+  }
+  const double atlas = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / RENDERS;
+
+  printf("\"%s\" in Font4x6 takes %.0f ns to draw from glyphFor() and %.0f ns from the atlas\n",
+         text, perPixel, atlas);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+
+#include "Display.h"
+#include "LedMatrix.h"
+#include "Max7219.h"
+#include "RecordingTransport.h"
+
+// Cost of pushing one full frame to the chain, before and after.
+//
+// The old LedMatrix::set() called LedControl::setLed() for every pixel, and
+// each call shifted out one word per device: the changed register for its
+// device and no-ops for the rest. Both new transports are handed the same
+// frames by Max7219; HardwareSpiTransport clocks every byte out of the SPI
+// peripheral in 8 SCK cycles, while BitBangTransport calls shiftOut(), which
+// writes DIN, CLK high and CLK low for every bit, plus CS at each end.
+namespace {
+
+constexpr size_t FRAME_BYTES = NUM_DEVICES * 2;
+constexpr size_t PIXELS = (size_t)Display::COLUMNS * Display::ROWS;
+
+// GPIO writes BitBangTransport (or LedControl, which shifts the same way)
+// needs for a recorded stream
+size_t gpioWrites(const RecordingTransport& transport) {
+  return transport.byteCount() * 8 * 3 + transport.transactionCount() * 2;
+}
+
+// Replays the old LedMatrix::set(): one LedControl::setLed() per pixel,
+// with LedControl's per-device register cache and padded frames
+void ledControlFrame(Display& display, RecordingTransport& transport) {
+  uint8_t status[NUM_DEVICES * 8] = {};
+  for (uint8_t x = 0; x < Display::COLUMNS; ++x) {
+    for (uint8_t y = 0; y < Display::ROWS; ++y) {
+      const uint8_t device = (uint8_t)(y / 8 * (Display::COLUMNS / 8) + x / 8);
+      const uint8_t digit = x % 8;
+      uint8_t& value = status[device * 8 + digit];
+      if (display.getPixel(x, y)) {
+        value |= (uint8_t)(0x80 >> (y % 8));
+      } else {
+        value &= (uint8_t)~(0x80 >> (y % 8));
+      }
+      uint8_t frame[FRAME_BYTES] = {};
+      const size_t slot = (size_t)(NUM_DEVICES - 1 - device) * 2;
+      frame[slot] = (uint8_t)(Max7219::REG_DIGIT0 + digit);
+      frame[slot + 1] = value;
+      transport.transfer(frame, sizeof(frame));
+    }
+  }
+}
+
+class FrameBudget : public ::testing::Test {
+protected:
+  FrameBudget() : matrix(&transport) {
+    display.fill(true);
+    display.present();
+    transport.reset();
+  }
+
+  RecordingTransport transport;
+  LedMatrix matrix;
+  Display display;
+};
+
+TEST_F(FrameBudget, LedControlSentOnePaddedFramePerPixel) {
+  RecordingTransport ledControl;
+  ledControlFrame(display, ledControl);
+  EXPECT_EQ(ledControl.transactionCount(), PIXELS);
+  EXPECT_EQ(ledControl.byteCount(), PIXELS * FRAME_BYTES);
+  EXPECT_EQ(gpioWrites(ledControl), PIXELS * FRAME_BYTES * 24 + PIXELS * 2);
+}
+
+TEST_F(FrameBudget, TransportsSendOneFramePerDigit) {
+  matrix.set(&display);
+  EXPECT_EQ(transport.transactionCount(), (size_t)Max7219::DIGITS);
+  EXPECT_EQ(transport.byteCount(), Max7219::DIGITS * FRAME_BYTES);
+  // BitBangTransport
+  EXPECT_EQ(gpioWrites(transport), Max7219::DIGITS * FRAME_BYTES * 24 + Max7219::DIGITS * 2);
+  // HardwareSpiTransport: the same bytes in SCK cycles
+  EXPECT_EQ(transport.byteCount() * 8, Max7219::DIGITS * FRAME_BYTES * 8);
+}
+
+TEST_F(FrameBudget, Report) {
+  RecordingTransport ledControl;
+  ledControlFrame(display, ledControl);
+  matrix.set(&display);
+
+  const double spiMicros = transport.byteCount() * 8 * 1e6 / LED_MATRIX_SPI_HZ;
+  printf("full %ux%u frame on %d devices    transactions   bytes  GPIO writes\n",
+         (unsigned)Display::COLUMNS, (unsigned)Display::ROWS, NUM_DEVICES);
+  printf("  LedControl, setLed per pixel  %12zu %7zu %12zu\n",
+         ledControl.transactionCount(), ledControl.byteCount(), gpioWrites(ledControl));
+  printf("  BitBangTransport              %12zu %7zu %12zu\n",
+         transport.transactionCount(), transport.byteCount(), gpioWrites(transport));
+  printf("  HardwareSpiTransport          %12zu %7zu  %.1f us of SCK at %lu Hz\n",
+         transport.transactionCount(), transport.byteCount(), spiMicros, (unsigned long)LED_MATRIX_SPI_HZ);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,149 @@
+#include <gtest/gtest.h>
+
+#include <new>
+#include <stdlib.h>
+
+#include "Display.h"
+#include "LedMatrix.h"
+#include "RecordingTransport.h"
+#include "Snow.h"
+#include "Visualization.h"
+#include "Visualizations.h"
+
+// Every C++ heap allocation in this binary goes through these, so a test
+// can tell whether a stretch of code touched the heap
+namespace {
+size_t allocations = 0;
+size_t deallocations = 0;
+}
+
+void* operator new(size_t size) {
+  ++allocations;
+  if (void* p = malloc(size ? size : 1)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  ++allocations;
+  return malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept {
+  return operator new(size, tag);
+}
+
+void operator delete(void* p) noexcept {
+  if (p) {
+    ++deallocations;
+    free(p);
+  }
+}
+
+void operator delete[](void* p) noexcept {
+  operator delete(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+  operator delete(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+  operator delete(p);
+}
+
+namespace {
+
+// Counts heap traffic between construction and stop()
+class HeapWatch {
+public:
+  HeapWatch() : allocated(allocations), freed(deallocations) {}
+
+  void stop() {
+    allocated = allocations - allocated;
+    freed = deallocations - freed;
+  }
+
+  size_t allocated;
+  size_t freed;
+};
+
+class HeapTest : public ::testing::Test {
+protected:
+  HeapTest() : matrix(&transport), now(0) {}
+
+  ~HeapTest() override {
+    destroyVisualizations();
+  }
+
+  // Run `visualization` for `ticks` loop() iterations: tick it, publish the
+  // frame and flush it to the chain
+  void run(Visualization* visualization, int ticks) {
+    for (int i = 0; i < ticks; ++i) {
+      now += 10;
+      visualization->check(now);
+      display.present();
+      matrix.beginFlush(&display);
+      while (matrix.flushStep()) {}
+    }
+  }
+
+  // Activate every definition in turn; with more definitions than cache
+  // slots this constructs, suspends, resumes and evicts instances
+  void cycle(int ticks) {
+    size_t count = 0;
+    const VisualizationDefinition* definitions = availableVisualizations(&count);
+    for (size_t i = 0; i < count; ++i) {
+      display.clear();
+      Visualization* visualization = activateVisualization(&definitions[i], &display);
+      ASSERT_NE(visualization, nullptr) << definitions[i].id;
+      run(visualization, ticks);
+    }
+  }
+
+  RecordingTransport transport;
+  LedMatrix matrix;
+  Display display;
+  unsigned long now;
+};
+
+TEST_F(HeapTest, ActivationAndEvictionDoNotAllocate) {
+  size_t count = 0;
+  availableVisualizations(&count);
+  ASSERT_GT(count, (size_t)VISUALIZATION_CACHE_SLOTS) << "eviction needs more definitions than slots";
+
+  // First use may set up process-wide state, e.g. the C library's time zone
+  cycle(1);
+
+  HeapWatch watch;
+  for (int round = 0; round < 20; ++round) {
+    cycle(50);
+  }
+  watch.stop();
+  EXPECT_EQ(watch.allocated, 0u);
+  EXPECT_EQ(watch.freed, 0u);
+}
+
+TEST_F(HeapTest, SnowTicksDoNotAllocate) {
+  // Fast snowfall and melting, so the melt path runs on most ticks
+  Snow snow(&display, 10, 10, 20, 50);
+  run(&snow, 1);
+
+  HeapWatch watch;
+  run(&snow, 10000);
+  watch.stop();
+  EXPECT_EQ(watch.allocated, 0u);
+  EXPECT_EQ(watch.freed, 0u);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,284 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <climits>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "JsonWriter.h"
+
+// Counts every C++ heap allocation in this binary, so a test can tell
+// whether serializing touched the heap
+namespace {
+size_t allocations = 0;
+}
+
+void* operator new(size_t size) {
+  ++allocations;
+  if (void* p = malloc(size ? size : 1)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+  if (p) {
+    free(p);
+  }
+}
+
+void operator delete[](void* p) noexcept {
+  operator delete(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+  operator delete(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+  operator delete(p);
+}
+
+namespace {
+
+// Collects what a JsonWriter hands it in a fixed buffer, like the
+// AsyncResponseStream the web server streams into
+class CaptureSink : public Print {
+public:
+  CaptureSink() : length(0), writes(0), largestWrite(0) {
+    data[0] = '\0';
+  }
+
+  size_t write(uint8_t c) override {
+    return write(&c, 1);
+  }
+
+  size_t write(const uint8_t* bytes, size_t size) override {
+    ++writes;
+    largestWrite = size > largestWrite ? size : largestWrite;
+    const size_t n = size < sizeof(data) - 1 - length ? size : sizeof(data) - 1 - length;
+    memcpy(data + length, bytes, n);
+    length += n;
+    data[length] = '\0';
+    return n;
+  }
+
+  char data[4096];
+  size_t length;
+  size_t writes;
+  size_t largestWrite;
+};
+
+// A document with nesting, every value type and escapes, the way the web
+// server's larger responses look
+void writeDocument(JsonWriter& json) {
+  json.beginObject()
+      .field("current", "marquee")
+      .key("visualizations").beginArray();
+  for (int i = 0; i < 12; ++i) {
+    json.beginObject()
+        .field("id", "snow")
+        .field("label", "Say \"hi\"\\n")
+        .field("index", i)
+        .field("enabled", i % 2 == 0)
+        .key("parameters").beginArray().endArray()
+        .key("range").beginArray().value(-1L).value(4294967295UL).null().endArray()
+        .endObject();
+  }
+  json.endArray().endObject();
+}
+
+TEST(JsonWriter, EscapesStringsAndKeys) {
+  char buffer[128];
+  JsonWriter json(buffer, sizeof(buffer));
+  json.beginObject()
+      .field("quote\"key", "a\"b\\c")
+      .field("control", "tab\tnl\n\x01\x1f")
+      .field("bytes", "\x7f\xc3\xa9")
+      .endObject();
+  EXPECT_FALSE(json.overflowed());
+  EXPECT_STREQ(json.c_str(),
+               "{\"quote\\\"key\":\"a\\\"b\\\\c\","
+               "\"control\":\"tab\\u0009nl\\u000a\\u0001\\u001f\","
+               "\"bytes\":\"\x7f\xc3\xa9\"}");
+  EXPECT_EQ(json.length(), strlen(json.c_str()));
+}
+
+TEST(JsonWriter, WritesNumbersAndLiterals) {
+  char buffer[128];
+  JsonWriter json(buffer, sizeof(buffer));
+  json.beginArray()
+      .value(0).value(-7).value(LONG_MIN).value(ULLONG_MAX)
+      .value(true).value(false).null().value((const char*)nullptr)
+      .endArray();
+  char expected[128];
+  snprintf(expected, sizeof(expected), "[0,-7,%ld,%llu,true,false,null,null]", LONG_MIN, ULLONG_MAX);
+  EXPECT_STREQ(json.c_str(), expected);
+}
+
+TEST(JsonWriter, SeparatesElementsAtEveryDepth) {
+  char buffer[256];
+  JsonWriter json(buffer, sizeof(buffer));
+  json.beginObject()
+      .key("a").beginArray()
+          .value(1)
+          .beginObject().key("b").beginArray().endArray().key("c").beginObject().endObject().endObject()
+          .beginArray().value(2).value(3).endArray()
+      .endArray()
+      .field("d", "x")
+      .key("e").beginArray().beginArray().endArray().beginArray().endArray().endArray()
+      .endObject();
+  EXPECT_STREQ(json.c_str(), "{\"a\":[1,{\"b\":[],\"c\":{}},[2,3]],\"d\":\"x\",\"e\":[[],[]]}");
+}
+
+TEST(JsonWriter, SeparatesElementsUpToMaxDepth) {
+  char buffer[512];
+  JsonWriter json(buffer, sizeof(buffer));
+  char expected[512];
+  char* out = expected;
+  // Two elements in every array down to the deepest tracked level, with the
+  // outer array's second element written after its first one closed
+  for (uint8_t d = 0; d + 1 < JsonWriter::MAX_DEPTH; ++d) {
+    json.beginArray().value(d);
+    out += sprintf(out, d == 0 ? "[%u" : ",[%u", (unsigned)d);
+  }
+  for (uint8_t d = JsonWriter::MAX_DEPTH - 1; d-- > 0;) {
+    json.endArray();
+    *out++ = ']';
+    if (d > 0) {
+      json.value(d);
+      out += sprintf(out, ",%u", (unsigned)d);
+    }
+  }
+  *out = '\0';
+  EXPECT_FALSE(json.overflowed());
+  EXPECT_STREQ(json.c_str(), expected);
+}
+
+TEST(JsonWriter, TruncatesWithoutSink) {
+  char buffer[16];
+  memset(buffer, 'x', sizeof(buffer));
+  JsonWriter json(buffer, sizeof(buffer));
+  json.beginObject().field("text", "longer than the buffer").endObject();
+  EXPECT_TRUE(json.overflowed());
+  // Everything that fit, NUL-terminated inside the buffer
+  EXPECT_EQ(json.length(), sizeof(buffer) - 1);
+  EXPECT_EQ(buffer[sizeof(buffer) - 1], '\0');
+  EXPECT_STREQ(json.c_str(), "{\"text\":\"longer");
+}
+
+TEST(JsonWriter, FitsExactlyWithoutOverflow) {
+  char buffer[8];
+  JsonWriter json(buffer, sizeof(buffer));
+  json.beginArray().value(12345).endArray();
+  EXPECT_FALSE(json.overflowed());
+  EXPECT_STREQ(json.c_str(), "[12345]");
+
+  JsonWriter tooLong(buffer, sizeof(buffer));
+  tooLong.beginArray().value(123456).endArray();
+  EXPECT_TRUE(tooLong.overflowed());
+  EXPECT_STREQ(tooLong.c_str(), "[123456");
+}
+
+TEST(JsonWriter, EmptyBufferOnlyOverflows) {
+  JsonWriter json(nullptr, 0);
+  json.beginObject().field("a", 1).endObject();
+  EXPECT_TRUE(json.overflowed());
+  EXPECT_STREQ(json.c_str(), "");
+  EXPECT_EQ(json.length(), 0u);
+}
+
+TEST(JsonWriter, StreamsThroughSinkInChunks) {
+  char whole[4096];
+  JsonWriter reference(whole, sizeof(whole));
+  writeDocument(reference);
+  ASSERT_FALSE(reference.overflowed());
+
+  for (size_t capacity : {2, 3, 16, 64, 1000}) {
+    char buffer[1000];
+    CaptureSink sink;
+    JsonWriter json(buffer, capacity, &sink);
+    writeDocument(json);
+    json.flush();
+    EXPECT_FALSE(json.overflowed()) << "capacity " << capacity;
+    EXPECT_EQ(json.length(), 0u);
+    EXPECT_STREQ(sink.data, reference.c_str()) << "capacity " << capacity;
+    // Never more than the staging area at once, and not byte by byte
+    EXPECT_LE(sink.largestWrite, capacity - 1);
+    EXPECT_LE(sink.writes, reference.length() / (capacity - 1) + 1);
+  }
+}
+
+TEST(JsonWriter, FlushWithoutSinkKeepsTheDocument) {
+  char buffer[32];
+  JsonWriter json(buffer, sizeof(buffer));
+  json.beginArray().value(1).endArray();
+  json.flush();
+  EXPECT_STREQ(json.c_str(), "[1]");
+}
+
+TEST(JsonWriter, SerializingDoesNotAllocate) {
+  const size_t before = allocations;
+  char whole[4096];
+  JsonWriter json(whole, sizeof(whole));
+  writeDocument(json);
+
+  char buffer[64];
+  CaptureSink sink;
+  JsonWriter streamed(buffer, sizeof(buffer), &sink);
+  writeDocument(streamed);
+  streamed.flush();
+
+  char small[16];
+  JsonWriter truncated(small, sizeof(small));
+  writeDocument(truncated);
+
+  EXPECT_EQ(allocations - before, 0u);
+  EXPECT_STREQ(sink.data, json.c_str());
+  EXPECT_TRUE(truncated.overflowed());
+}
+
+TEST(JsonWriter, Benchmark) {
+  using Clock = std::chrono::steady_clock;
+  constexpr int DOCUMENTS = 20000;
+  char whole[4096];
+  char buffer[256];
+  volatile size_t sink = 0;
+
+  auto start = Clock::now();
+  for (int i = 0; i < DOCUMENTS; ++i) {
+    JsonWriter json(whole, sizeof(whole));
+    writeDocument(json);
+    sink = sink + json.length();
+  }
+  const double buffered = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / DOCUMENTS;
+
+  start = Clock::now();
+  for (int i = 0; i < DOCUMENTS; ++i) {
+    CaptureSink capture;
+    JsonWriter json(buffer, sizeof(buffer), &capture);
+    writeDocument(json);
+    json.flush();
+    sink = sink + capture.length;
+  }
+  const double streamed = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / DOCUMENTS;
+
+  JsonWriter json(whole, sizeof(whole));
+  writeDocument(json);
+  printf("JsonWriter, %u-byte document\n", (unsigned)json.length());
+  printf("  into one buffer            %6.0f ns\n", buffered);
+  printf("  through a %3u-byte buffer   %6.0f ns\n", (unsigned)sizeof(buffer), streamed);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
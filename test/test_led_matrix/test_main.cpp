@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+
+#include "Display.h"
+#include "LedMatrix.h"
+#include "Max7219.h"
+#include "RecordingTransport.h"
+
+namespace {
+
+constexpr size_t FRAME_BYTES = NUM_DEVICES * 2;
+
+// Index of the register byte of `device` within a recorded frame: the first
+// word shifted out ends up in the device farthest from DIN
+size_t slotOf(uint8_t device) {
+  return (size_t)(NUM_DEVICES - 1 - device) * 2;
+}
+
+class LedMatrixTest : public ::testing::Test {
+protected:
+  LedMatrixTest() : matrix(&transport) {
+    transport.reset();
+  }
+
+  // Publish the drawn frame and push every digit it changed to the chain
+  void flush() {
+    display.present();
+    matrix.set(&display);
+  }
+
+  // Frame `index` of the recording
+  const uint8_t* frame(size_t index) const {
+    return transport.bytes() + index * FRAME_BYTES;
+  }
+
+  RecordingTransport transport;
+  LedMatrix matrix;
+  Display display;
+};
+
+TEST(LedMatrixBegin, InitializesTheChainWithOneFramePerRegister) {
+  RecordingTransport transport;
+  LedMatrix matrix(&transport);
+  EXPECT_TRUE(transport.begun());
+  // Display test, scan limit, decode mode, eight blank digits, intensity
+  // and shutdown, each written to the whole chain at once
+  EXPECT_EQ(transport.transactionCount(), 13u);
+  EXPECT_EQ(transport.byteCount(), 13u * FRAME_BYTES);
+}
+
+TEST_F(LedMatrixTest, WritesOneFramePerChangedDigit) {
+  display.setPixel(3, 0, true);
+  flush();
+  ASSERT_EQ(transport.transactionCount(), 1u);
+  ASSERT_EQ(transport.byteCount(), FRAME_BYTES);
+  for (uint8_t device = 0; device < NUM_DEVICES; ++device) {
+    EXPECT_EQ(frame(0)[slotOf(device)], Max7219::REG_DIGIT0 + 3);
+  }
+}
+
+TEST_F(LedMatrixTest, FullFrameCostsOneFramePerDigit) {
+  // LedControl needed one no-op padded transaction per device and digit
+  display.fill(true);
+  flush();
+  EXPECT_EQ(transport.transactionCount(), (size_t)Max7219::DIGITS);
+  EXPECT_EQ(transport.byteCount(), Max7219::DIGITS * FRAME_BYTES);
+}
+
+TEST_F(LedMatrixTest, PlacesDeviceValuesInReverseChainOrder) {
+  // Column 1 of device 0 and of the last device in the first band, rows 0 and 7
+  const uint8_t lastDevice = Display::COLUMNS / 8 - 1;
+  display.setPixel(1, 0, true);
+  display.setPixel((uint8_t)(lastDevice * 8 + 1), 7, true);
+  flush();
+  ASSERT_EQ(transport.transactionCount(), 1u);
+  for (uint8_t device = 0; device < NUM_DEVICES; ++device) {
+    uint8_t expected = 0;
+    if (device == 0) {
+      expected = 0x80;
+    } else if (device == lastDevice) {
+      expected = 0x01;
+    }
+    EXPECT_EQ(frame(0)[slotOf(device)], Max7219::REG_DIGIT0 + 1);
+    EXPECT_EQ(frame(0)[slotOf(device) + 1], expected) << "device " << (int)device;
+  }
+}
+
+TEST_F(LedMatrixTest, SendsEachChangedDigitOnce) {
+  display.setPixel(0, 0, true);
+  display.setPixel(0, 5, true);
+  display.setPixel(6, 2, true);
+  flush();
+  ASSERT_EQ(transport.transactionCount(), 2u);
+  EXPECT_EQ(frame(0)[0], Max7219::REG_DIGIT0 + 0);
+  EXPECT_EQ(frame(1)[0], Max7219::REG_DIGIT0 + 6);
+}
+
+TEST_F(LedMatrixTest, SkipsUnchangedDigits) {
+  display.setPixel(2, 4, true);
+  flush();
+  transport.reset();
+
+  // Same frame again: nothing to send
+  display.setPixel(2, 4, true);
+  flush();
+  EXPECT_EQ(transport.transactionCount(), 0u);
+
+  // Dirty, but back to what the devices already show
+  display.setPixel(2, 4, false);
+  display.setPixel(2, 4, true);
+  flush();
+  EXPECT_EQ(transport.transactionCount(), 0u);
+
+  // A pixel that was already on next to one that changes: only that digit
+  display.setPixel(2, 4, true);
+  display.setPixel(5, 1, true);
+  flush();
+  ASSERT_EQ(transport.transactionCount(), 1u);
+  EXPECT_EQ(frame(0)[slotOf(0)], Max7219::REG_DIGIT0 + 5);
+}
+
+TEST_F(LedMatrixTest, FlushesWithinTheDigitBudget) {
+  matrix.setFlushBudget(2);
+  for (uint8_t x = 0; x < 8; ++x) {
+    display.setPixel(x, x, true);
+  }
+  display.present();
+  ASSERT_TRUE(matrix.beginFlush(&display));
+  EXPECT_TRUE(matrix.flushStep());
+  EXPECT_EQ(transport.transactionCount(), 2u);
+  while (matrix.flushStep()) {
+  }
+  EXPECT_EQ(transport.transactionCount(), 8u);
+  EXPECT_FALSE(matrix.flushing());
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <stdint.h>
+#include <thread>
+
+#include "Snapshot.h"
+
+namespace {
+
+// Every word holds the same number, so a copy mixed from two publishes shows
+struct Frame {
+  uint32_t words[16];
+};
+
+void fill(Frame& frame, uint32_t value) {
+  for (uint32_t& word : frame.words) {
+    word = value;
+  }
+}
+
+TEST(Snapshot, ReadsTheNewestPublishedCopy) {
+  Snapshot<int> snapshot;
+  EXPECT_EQ(snapshot.read(), 0);
+
+  snapshot.edit() = 1;
+  EXPECT_EQ(snapshot.read(), 0) << "an unpublished copy must not be visible";
+  snapshot.publish();
+  EXPECT_EQ(snapshot.read(), 1);
+  EXPECT_EQ(snapshot.read(), 1);
+
+  // Copies published in between reads are skipped
+  for (int i = 2; i <= 5; ++i) {
+    snapshot.edit() = i;
+    snapshot.publish();
+  }
+  EXPECT_EQ(snapshot.read(), 5);
+}
+
+TEST(Snapshot, ReadCopyStaysUntilTheNextRead) {
+  Snapshot<int> snapshot;
+  snapshot.edit() = 1;
+  snapshot.publish();
+  const int& held = snapshot.read();
+  for (int i = 2; i <= 10; ++i) {
+    snapshot.edit() = i;
+    snapshot.publish();
+    ASSERT_EQ(held, 1) << "the writer overwrote the reader's copy";
+  }
+  EXPECT_EQ(snapshot.read(), 10);
+}
+
+// A writer thread publishes numbered frames while the reader reads them.
+// Every copy read must be whole, and the numbers must never go backwards.
+TEST(Snapshot, WriterAndReaderThreads) {
+  constexpr uint32_t TOTAL = 200000;
+  Snapshot<Frame> snapshot;
+  std::atomic<bool> stop(false);
+  std::thread writer([&] {
+    for (uint32_t i = 1; i <= TOTAL && !stop.load(); ++i) {
+      fill(snapshot.edit(), i);
+      snapshot.publish();
+    }
+  });
+
+  struct Joiner {
+    ~Joiner() {
+      stop.store(true);
+      thread.join();
+    }
+    std::atomic<bool>& stop;
+    std::thread& thread;
+  } joiner{stop, writer};
+
+  uint32_t last = 0;
+  while (last < TOTAL) {
+    const Frame& frame = snapshot.read();
+    for (uint32_t word : frame.words) {
+      ASSERT_EQ(word, frame.words[0]) << "torn copy";
+    }
+    ASSERT_GE(frame.words[0], last);
+    last = frame.words[0];
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,165 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <random>
+#include <stdio.h>
+#include <string.h>
+
+#include "Display.h"
+#include "Transform.h"
+
+// Transform::apply() is checked against a per-pixel model of the documented
+// order: rotation (clockwise), mirror, flip, offset with wrap-around and
+// inversion. The panel geometry is a compile-time setting, so other sizes
+// are covered by building this with e.g. -D LED_MATRIX_ROWS=32 -D
+// NUM_DEVICES=16 (32x32) or additionally -D LED_MATRIX_COLS=64 -D
+// NUM_DEVICES=64 (64x64).
+namespace {
+
+using Row = Display::Row;
+constexpr uint8_t W = Display::COLUMNS;
+constexpr uint8_t H = Display::ROWS;
+
+void referenceApply(const Transform& transform, const Row* in, Row* out) {
+  for (uint8_t y = 0; y < H; ++y) {
+    out[y] = 0;
+  }
+  for (uint8_t y = 0; y < H; ++y) {
+    for (uint8_t x = 0; x < W; ++x) {
+      if (!(in[y] & Display::bit(x))) {
+        continue;
+      }
+      int tx = x;
+      int ty = y;
+      switch (transform.getRotation()) {
+        case Transform::Rotation::R90: tx = W - 1 - y; ty = x; break;
+        case Transform::Rotation::R180: tx = W - 1 - x; ty = H - 1 - y; break;
+        case Transform::Rotation::R270: tx = y; ty = W - 1 - x; break;
+        case Transform::Rotation::R0: break;
+      }
+      if (transform.getMirror()) {
+        tx = W - 1 - tx;
+      }
+      if (transform.getFlip()) {
+        ty = H - 1 - ty;
+      }
+      tx = (tx + transform.getOffsetX()) % W;
+      ty = (ty + transform.getOffsetY()) % H;
+      out[ty] |= Display::bit((uint8_t)tx);
+    }
+  }
+  if (transform.getInvert()) {
+    for (uint8_t y = 0; y < H; ++y) {
+      out[y] = (Row)(~out[y] & Display::FULL_ROW);
+    }
+  }
+}
+
+void randomFrame(std::mt19937& random, Row* rows) {
+  for (uint8_t y = 0; y < H; ++y) {
+    rows[y] = (Row)(((uint64_t)random() << 32 | random()) & Display::FULL_ROW);
+  }
+}
+
+TEST(Transform, IdentityCopiesTheFrame) {
+  std::mt19937 random(1);
+  Row in[H];
+  Row out[H];
+  randomFrame(random, in);
+  Transform transform;
+  EXPECT_TRUE(transform.identity());
+  transform.apply(in, out);
+  EXPECT_EQ(0, memcmp(in, out, sizeof(in)));
+}
+
+TEST(Transform, QuarterTurnsOnlyOnSquarePanels) {
+  const bool quarterTurns = Transform::QUARTER_TURNS;
+  Transform transform;
+  EXPECT_EQ(transform.setRotation(Transform::Rotation::R90), quarterTurns);
+  EXPECT_EQ(transform.setRotation(Transform::Rotation::R270), quarterTurns);
+  EXPECT_TRUE(transform.setRotation(Transform::Rotation::R180));
+}
+
+TEST(Transform, MatchesPerPixelModel) {
+  const Transform::Rotation rotations[] = {
+    Transform::Rotation::R0, Transform::Rotation::R90, Transform::Rotation::R180, Transform::Rotation::R270,
+  };
+  const int16_t offsets[] = {0, 1, 7, -3, W + 5};
+  std::mt19937 random(2);
+  for (Transform::Rotation rotation : rotations) {
+    for (uint8_t flags = 0; flags < 8; ++flags) {
+      for (int16_t dx : offsets) {
+        for (int16_t dy : offsets) {
+          Transform transform;
+          if (!transform.setRotation(rotation)) {
+            continue;
+          }
+          transform.setMirror(flags & 1);
+          transform.setFlip(flags & 2);
+          transform.setInvert(flags & 4);
+          transform.setOffset(dx, dy);
+          for (int i = 0; i < 4; ++i) {
+            Row in[H];
+            Row expected[H];
+            Row actual[H];
+            randomFrame(random, in);
+            referenceApply(transform, in, expected);
+            transform.apply(in, actual);
+            ASSERT_EQ(0, memcmp(expected, actual, sizeof(expected)))
+                << "rotation " << Transform::degrees(rotation) << " flags " << (int)flags
+                << " offset " << dx << "," << dy;
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST(Transform, Benchmark) {
+  using Clock = std::chrono::steady_clock;
+  constexpr int FRAMES = 20000;
+  std::mt19937 random(3);
+  Row in[H];
+  Row out[H];
+  randomFrame(random, in);
+  Transform transform;
+  transform.setRotation(Transform::QUARTER_TURNS ? Transform::Rotation::R90 : Transform::Rotation::R180);
+  transform.setMirror(true);
+  transform.setOffset(3, 1);
+  volatile Row sink = 0;
+
+  auto start = Clock::now();
+  for (int i = 0; i < FRAMES; ++i) {
+    in[0] ^= (Row)i;
+    memcpy(out, in, sizeof(in));
+    sink = (Row)(sink ^ out[i % H]);
+  }
+  const double copy = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / FRAMES;
+
+  start = Clock::now();
+  for (int i = 0; i < FRAMES; ++i) {
+    in[0] ^= (Row)i;
+    transform.apply(in, out);
+    sink = (Row)(sink ^ out[i % H]);
+  }
+  const double rows = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / FRAMES;
+
+  start = Clock::now();
+  for (int i = 0; i < FRAMES; ++i) {
+    in[0] ^= (Row)i;
+    referenceApply(transform, in, out);
+    sink = (Row)(sink ^ out[i % H]);
+  }
+  const double perPixel = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / FRAMES;
+
+  printf("Transform::apply takes %.0f ns per %ux%u frame at %u degrees with mirror and offset "
+         "(a plain row copy takes %.0f ns, the per-pixel model %.0f ns)\n",
+         rows, (unsigned)W, (unsigned)H, (unsigned)Transform::degrees(transform.getRotation()), copy, perPixel);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}